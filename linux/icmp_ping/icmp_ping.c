@@ -12,6 +12,7 @@
 #include <stdlib.h>
 #include <sys/socket.h>
 #include <unistd.h>
+#include <poll.h>
 
 #define ICMP_ECHO 8      /* Echo Request			*/
 #define ICMP_ECHOREPLY 0 /* Echo Reply			*/
@@ -248,18 +249,512 @@ int ping(const char *ip)
     return 0;
 }
 
+/**
+ * @brief 多目标模式的探测包，载荷中带上目标下标和轮次，应答不依赖 seq 就能对应回目标
+ */
+struct __attribute__((__packed__)) icmp_probe
+{
+    uint8_t type;          /**< 类型 */
+    uint8_t code;          /**< 代码 */
+    uint16_t checksum;     /**< 校验和 */
+    uint16_t ident;        /**< 标识符 */
+    uint16_t seq;          /**< 序列号 */
+    double sending_ts;     /**< 发送时间戳 */
+    uint32_t target;       /**< 目标下标 */
+    uint16_t round;        /**< 轮次 */
+    char magic[MAGIC_LEN]; /**< 魔术字符串 */
+};
+
+/**
+ * @brief 多目标模式的一个目标
+ */
+struct target
+{
+    struct in_addr addr; /**< 目标地址 */
+    int received;        /**< 收到的应答数 */
+    float *rtts;         /**< 每一轮的往返时间 ms，未收到为负数 */
+};
+
+/**
+ * @brief 多目标模式的参数
+ */
+struct multi_config
+{
+    int count;         /**< 每个目标的探测次数 */
+    double period;     /**< 同一目标两次探测的间隔（秒） */
+    double rate;       /**< 全局发包速率（包/秒） */
+    double timeout;    /**< 单个探测包的超时时间（秒） */
+    double deadline;   /**< 整体截止时间（秒），0 表示不限制 */
+};
+
+#define MAX_TARGETS (1 << 20)        /**< 最大目标数 */
+#define MULTI_RCVBUF (4 * 1024 * 1024) /**< 多目标模式的接收缓冲区大小 */
+
+static struct target *targets = NULL;
+static int targets_len = 0;
+static int targets_cap = 0;
+static long replies = 0; // 所有目标收到的有效应答总数
+
+/**
+ * @brief 添加一个目标
+ * @param addr 目标地址
+ * @return 成功返回0，超过 MAX_TARGETS 或内存不足返回-1
+ */
+int add_target(struct in_addr addr)
+{
+    if (targets_len >= MAX_TARGETS)
+    {
+        fprintf(stderr, "too many targets (max %d)\n", MAX_TARGETS);
+        return -1;
+    }
+    if (targets_len == targets_cap)
+    {
+        int cap = targets_cap == 0 ? 256 : targets_cap * 2;
+        struct target *grown = realloc(targets, sizeof(struct target) * cap);
+        if (grown == NULL)
+        {
+            perror("allocate targets");
+            return -1;
+        }
+        targets = grown;
+        targets_cap = cap;
+    }
+    bzero(&targets[targets_len], sizeof(struct target));
+    targets[targets_len].addr = addr;
+    targets_len++;
+    return 0;
+}
+
+/**
+ * @brief 解析一个目标：IPv4 地址或 CIDR 网段（网段展开为其中的主机地址，/31 和 /32 以外不含网络地址和广播地址）
+ * @param spec 目标字符串
+ * @return 成功返回0，失败返回-1
+ */
+int parse_target(const char *spec)
+{
+    char buf[64];
+    strncpy(buf, spec, sizeof(buf) - 1);
+    buf[sizeof(buf) - 1] = '\0';
+
+    struct in_addr addr;
+    char *slash = strchr(buf, '/');
+    if (slash == NULL)
+    {
+        if (inet_aton(buf, &addr) == 0)
+        {
+            fprintf(stderr, "bad ip address: %s\n", spec);
+            return -1;
+        }
+        return add_target(addr);
+    }
+
+    *slash = '\0';
+    char *end;
+    long prefix = strtol(slash + 1, &end, 10);
+    if (inet_aton(buf, &addr) == 0 || *end != '\0' || end == slash + 1 || prefix < 0 || prefix > 32)
+    {
+        fprintf(stderr, "bad cidr: %s\n", spec);
+        return -1;
+    }
+
+    uint32_t mask = prefix == 0 ? 0 : 0xffffffffu << (32 - prefix);
+    uint64_t first = ntohl(addr.s_addr) & mask;
+    uint64_t last = first | ~mask;
+    if (prefix < 31)
+    {
+        first++;
+        last--;
+    }
+    if (last - first + 1 > (uint64_t)(MAX_TARGETS - targets_len))
+    {
+        fprintf(stderr, "cidr too large: %s\n", spec);
+        return -1;
+    }
+    for (uint64_t host = first; host <= last; host++)
+    {
+        addr.s_addr = htonl((uint32_t)host);
+        if (add_target(addr) == -1)
+        {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief 从文件读取目标，每行一个，忽略空行和 # 开头的注释
+ * @param fp 文件
+ * @return 成功返回0，失败返回-1
+ */
+int read_targets(FILE *fp)
+{
+    char line[256];
+    while (fgets(line, sizeof(line), fp) != NULL)
+    {
+        char *start = line;
+        while (*start == ' ' || *start == '\t')
+        {
+            start++;
+        }
+        char *end = start + strcspn(start, " \t\r\n#");
+        *end = '\0';
+        if (*start == '\0')
+        {
+            continue;
+        }
+        if (parse_target(start) == -1)
+        {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief 处理一个收到的报文，记录往返时间
+ * @param buffer 含 IP 头部的报文
+ * @param bytes 报文长度
+ * @param ident 标识符
+ * @param config 参数
+ */
+void handle_multi_reply(unsigned char *buffer, int bytes, int ident, const struct multi_config *config)
+{
+    int ip_header_len = (buffer[0] & 0xf) << 2;
+    if (bytes < ip_header_len + (int)sizeof(struct icmp_probe))
+    {
+        return;
+    }
+    struct icmp_probe *icmp = (struct icmp_probe *)(buffer + ip_header_len);
+    if (icmp->type != ICMP_ECHOREPLY || icmp->code != 0 || ntohs(icmp->ident) != ident)
+    {
+        return;
+    }
+
+    // 载荷中的目标下标和轮次必须有效，且应答来自该目标
+    uint32_t index = icmp->target;
+    uint16_t round = icmp->round;
+    if (index >= (uint32_t)targets_len || round >= config->count)
+    {
+        return;
+    }
+    struct target *target = &targets[index];
+    if (memcmp(buffer + 12, &target->addr, 4) != 0)
+    {
+        return;
+    }
+
+    double rtt = get_timestamp() - icmp->sending_ts;
+    if (target->rtts[round] >= 0 || rtt < 0 || rtt > config->timeout)
+    {
+        return; // 重复或超时的应答
+    }
+    target->rtts[round] = rtt * 1000;
+    target->received++;
+    replies++;
+}
+
+static int compare_float(const void *a, const void *b)
+{
+    float x = *(const float *)a;
+    float y = *(const float *)b;
+    return x < y ? -1 : x > y;
+}
+
+/**
+ * @brief 输出每个目标的汇总：发送/接收/丢包率，min/avg/max/p99
+ * @param sent 实际发送的探测包总数，按轮次依次发给各目标，据此算出每个目标的发送数
+ * @param count 每个目标的探测次数
+ * @return 成功返回0，出错返回-1
+ */
+int print_summary(long sent, int count)
+{
+    static char out_buf[1 << 16];
+    setvbuf(stdout, out_buf, _IOFBF, sizeof(out_buf));
+
+    float *sorted = malloc(sizeof(float) * (count > 0 ? count : 1));
+    if (sorted == NULL)
+    {
+        perror("allocate summary");
+        return -1;
+    }
+    for (int i = 0; i < targets_len; i++)
+    {
+        struct target *target = &targets[i];
+        // 截止时间到达时最后一轮可能只发给了前面的目标
+        int target_sent = (int)(sent / targets_len) + (i < sent % targets_len);
+        int n = 0;
+        double sum = 0;
+        for (int r = 0; r < target_sent; r++)
+        {
+            if (target->rtts[r] >= 0)
+            {
+                sorted[n++] = target->rtts[r];
+                sum += target->rtts[r];
+            }
+        }
+
+        int loss = target_sent > 0 ? (target_sent - n) * 100 / target_sent : 0;
+        printf("%-15s : xmt/rcv/%%loss = %d/%d/%d%%", inet_ntoa(target->addr), target_sent, n, loss);
+        if (n > 0)
+        {
+            qsort(sorted, n, sizeof(float), compare_float);
+            int p99 = (int)(n * 0.99);
+            if (p99 >= n)
+            {
+                p99 = n - 1;
+            }
+            printf(", min/avg/max/p99 = %.2f/%.2f/%.2f/%.2f", sorted[0], sum / n, sorted[n - 1], sorted[p99]);
+        }
+        printf("\n");
+    }
+    free(sorted);
+    fflush(stdout);
+    return 0;
+}
+
+/**
+ * @brief 多目标模式：一个套接字并发探测所有目标，发包按全局速率均匀分布，同一目标按 period 间隔
+ * @param config 参数
+ * @return 全部目标至少收到一个应答返回0，否则返回1，出错返回-1
+ */
+int ping_multi(const struct multi_config *config)
+{
+    int sock = socket(AF_INET, SOCK_RAW, IPPROTO_ICMP);
+    if (sock == -1)
+    {
+        perror("create raw socket");
+        return -1;
+    }
+    int rcvbuf = MULTI_RCVBUF;
+    setsockopt(sock, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+
+    // 所有目标的往返时间一次性分配
+    float *rtts = malloc(sizeof(float) * targets_len * config->count);
+    if (rtts == NULL)
+    {
+        perror("allocate rtts");
+        close(sock);
+        return -1;
+    }
+    for (long i = 0; i < (long)targets_len * config->count; i++)
+    {
+        rtts[i] = -1;
+    }
+    for (int i = 0; i < targets_len; i++)
+    {
+        targets[i].rtts = rtts + (long)i * config->count;
+    }
+
+    int ident = getpid() & 0xffff;
+    double start = get_timestamp();
+    double stop_ts = config->deadline > 0 ? start + config->deadline : 0;
+    double gap = 1.0 / config->rate;
+    double next_ts = start;
+    double round_start = start;
+    long total = (long)targets_len * config->count;
+    long sent = 0;
+    unsigned char buffer[IP_BUFFER_SIZE];
+
+    for (;;)
+    {
+        double now = get_timestamp();
+        if (stop_ts > 0 && now >= stop_ts)
+        {
+            break;
+        }
+
+        // 按轮次发送，每轮依次发给所有目标；同一目标两轮之间至少间隔 period
+        while (sent < total && now >= next_ts)
+        {
+            int index = sent % targets_len;
+            int round = sent / targets_len;
+            if (index == 0)
+            {
+                double earliest = round == 0 ? start : round_start + config->period;
+                if (now < earliest)
+                {
+                    next_ts = earliest;
+                    break;
+                }
+                round_start = now;
+            }
+
+            struct sockaddr_in addr;
+            bzero(&addr, sizeof(addr));
+            addr.sin_family = AF_INET;
+            addr.sin_addr = targets[index].addr;
+
+            struct icmp_probe icmp;
+            bzero(&icmp, sizeof(icmp));
+            icmp.type = ICMP_ECHO;
+            icmp.ident = htons(ident);
+            icmp.seq = htons((uint16_t)sent);
+            icmp.target = index;
+            icmp.round = round;
+            strncpy(icmp.magic, MAGIC, MAGIC_LEN);
+            icmp.sending_ts = get_timestamp();
+            icmp.checksum = htons(calculate_checksum((unsigned char *)&icmp, sizeof(icmp)));
+            if (sendto(sock, &icmp, sizeof(icmp), MSG_DONTWAIT, (struct sockaddr *)&addr, sizeof(addr)) == -1 &&
+                errno != EAGAIN && errno != ENOBUFS && errno != EHOSTUNREACH && errno != ENETUNREACH)
+            {
+                perror("Send failed");
+            }
+
+            sent++;
+            // 落后时不补发突发，从当前时间重新均匀排布
+            next_ts = next_ts + gap > now ? next_ts + gap : now;
+        }
+
+        // 全部发完后，最后一个包超时或全部收到即结束
+        if (sent == total)
+        {
+            if (replies == total || now >= next_ts + config->timeout)
+            {
+                break;
+            }
+        }
+
+        double wake_ts = sent < total ? next_ts : next_ts + config->timeout;
+        if (stop_ts > 0 && wake_ts > stop_ts)
+        {
+            wake_ts = stop_ts;
+        }
+        int timeout_ms = (int)((wake_ts - get_timestamp()) * 1000);
+        struct pollfd pfd = {sock, POLLIN, 0};
+        if (poll(&pfd, 1, timeout_ms > 0 ? timeout_ms : 0) <= 0)
+        {
+            continue;
+        }
+
+        // 读空接收队列
+        int bytes;
+        while ((bytes = recv(sock, buffer, sizeof(buffer), MSG_DONTWAIT)) > 0)
+        {
+            handle_multi_reply(buffer, bytes, ident, config);
+        }
+    }
+    close(sock);
+
+    if (print_summary(sent, config->count) != 0)
+    {
+        free(rtts);
+        return -1;
+    }
+
+    int all_alive = 1;
+    for (int i = 0; i < targets_len; i++)
+    {
+        if (targets[i].received == 0)
+        {
+            all_alive = 0;
+        }
+    }
+    free(rtts);
+    return all_alive ? 0 : 1;
+}
+
+/**
+ * @brief 输出用法
+ * @param prog 程序名
+ */
+void usage(const char *prog)
+{
+    fprintf(stderr,
+            "usage: %s <host>                 单目标，每秒一个包持续 ping\n"
+            "       %s [options] [targets...]  多目标并发探测，输出每个目标的汇总\n"
+            "  targets   IPv4 地址或 CIDR 网段，'-' 表示从标准输入读取\n"
+            "  -f file   从文件读取目标，每行一个\n"
+            "  -c count  每个目标的探测次数（默认 1）\n"
+            "  -p ms     同一目标两次探测的间隔（默认 1000）\n"
+            "  -r pps    全局发包速率（默认 10000）\n"
+            "  -t ms     单个探测包的超时时间（默认 1000）\n"
+            "  -w sec    整体截止时间（默认不限制）\n",
+            prog, prog);
+}
+
 /**
  * @brief 主函数，用于解析命令行参数并调用 ICMP Ping 函数
+ *        只给出一个地址且没有选项时保持原来的单目标模式，否则进入多目标模式
  * @param argc 命令行参数个数
  * @param argv 命令行参数列表
  * @return 程序执行结果的状态码，成功返回0，失败返回-1
  */
-int main(int argc, const char *argv[])
+int main(int argc, char *argv[])
 {
     if (argc < 2)
     {
-        fprintf(stderr, "no host specified");
+        usage(argv[0]);
         return -1;
     }
-    return ping(argv[1]);
+    if (argc == 2 && argv[1][0] != '-' && strchr(argv[1], '/') == NULL)
+    {
+        return ping(argv[1]);
+    }
+
+    struct multi_config config = {1, 1.0, 10000, 1.0, 0};
+    int opt;
+    while ((opt = getopt(argc, argv, "f:c:p:r:t:w:")) != -1)
+    {
+        switch (opt)
+        {
+        case 'f':
+        {
+            FILE *fp = strcmp(optarg, "-") == 0 ? stdin : fopen(optarg, "r");
+            if (fp == NULL)
+            {
+                perror(optarg);
+                return -1;
+            }
+            int ret = read_targets(fp);
+            if (fp != stdin)
+            {
+                fclose(fp);
+            }
+            if (ret == -1)
+            {
+                return -1;
+            }
+            break;
+        }
+        case 'c':
+            config.count = atoi(optarg);
+            break;
+        case 'p':
+            config.period = atof(optarg) / 1000;
+            break;
+        case 'r':
+            config.rate = atof(optarg);
+            break;
+        case 't':
+            config.timeout = atof(optarg) / 1000;
+            break;
+        case 'w':
+            config.deadline = atof(optarg);
+            break;
+        default:
+            usage(argv[0]);
+            return -1;
+        }
+    }
+    if (config.count <= 0 || config.count > 65535 || config.period < 0 || config.rate <= 0 || config.timeout <= 0)
+    {
+        usage(argv[0]);
+        return -1;
+    }
+
+    for (int i = optind; i < argc; i++)
+    {
+        int ret = strcmp(argv[i], "-") == 0 ? read_targets(stdin) : parse_target(argv[i]);
+        if (ret == -1)
+        {
+            return -1;
+        }
+    }
+    if (targets_len == 0)
+    {
+        fprintf(stderr, "no host specified\n");
+        return -1;
+    }
+
+    return ping_multi(&config);
 }
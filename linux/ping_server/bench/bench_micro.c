@@ -0,0 +1,109 @@
+/**
+ * @file bench_micro.c
+ * @brief 热点函数微基准：calculate_checksum、parse_request、响应序列化
+ */
+
+#include <time.h>
+
+#include "http_server.h"
+
+#define BENCH_DEFAULT_ITERATIONS 1000000
+
+/**
+ * @brief 获取单调时钟（纳秒）
+ * @return 当前时间
+ */
+static double now_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static volatile uint64_t sink; // 防止编译器优化掉被测代码
+
+/**
+ * @brief 输出一项基准结果
+ * @param name 名称
+ * @param iterations 迭代次数
+ * @param elapsed_ns 总耗时（纳秒）
+ */
+static void report(const char *name, long iterations, double elapsed_ns)
+{
+    printf("%-28s %12ld iter %10.1f ns/op %12.0f op/s\n", name, iterations, elapsed_ns / iterations, iterations / (elapsed_ns / 1e9));
+}
+
+static void bench_checksum(long iterations)
+{
+    struct icmp_echo icmp;
+    bzero(&icmp, sizeof(icmp));
+    icmp.type = ICMP_ECHO;
+    icmp.ident = htons(1234);
+    strncpy(icmp.magic, MAGIC, MAGIC_LEN);
+
+    double start = now_ns();
+    for (long i = 0; i < iterations; i++)
+    {
+        icmp.seq = (uint16_t)i;
+        sink += calculate_checksum((unsigned char *)&icmp, sizeof(icmp));
+    }
+    report("calculate_checksum", iterations, now_ns() - start);
+}
+
+static void bench_parse_request(long iterations)
+{
+    const char *request = "GET /?ip=192.168.100.200&icmp_num=10 HTTP/1.1\r\nHost: localhost:8080\r\nUser-Agent: bench\r\nAccept: */*\r\n\r\n";
+    char ip[16];
+    int icmp_num;
+
+    double start = now_ns();
+    for (long i = 0; i < iterations; i++)
+    {
+        sink += parse_request(request, ip, &icmp_num) + icmp_num;
+    }
+    report("parse_request", iterations, now_ns() - start);
+}
+
+static void bench_format_results(long iterations)
+{
+    static struct ping_result results[MAX_RESULTS];
+    static char buffer[MAX_RESULTS * RESULT_LINE_SIZE];
+    for (int i = 0; i < MAX_RESULTS; i++)
+    {
+        strcpy(results[i].ipv4_source, "192.168.1.10");
+        strcpy(results[i].ipv4_target, "10.200.1.123");
+        results[i].seq = i + 1;
+        results[i].time = 12.345 + i;
+        results[i].status = i % 10 == 0 ? PING_STATUS_TIMEOUT : PING_STATUS_OK;
+    }
+
+    // 每次序列化 MAX_RESULTS 行，按行计算
+    long rounds = iterations / MAX_RESULTS > 0 ? iterations / MAX_RESULTS : 1;
+    double start = now_ns();
+    for (long i = 0; i < rounds; i++)
+    {
+        sink += format_ping_results(buffer, sizeof(buffer), results, MAX_RESULTS);
+    }
+    report("format_ping_results (line)", rounds * MAX_RESULTS, now_ns() - start);
+}
+
+/**
+ * @brief 主函数
+ * @param argc 命令行参数个数
+ * @param argv argv[1] 可选，迭代次数
+ * @return 0
+ */
+int main(int argc, const char *argv[])
+{
+    long iterations = argc > 1 ? atol(argv[1]) : BENCH_DEFAULT_ITERATIONS;
+    if (iterations <= 0)
+    {
+        fprintf(stderr, "usage: %s [iterations]\n", argv[0]);
+        return -1;
+    }
+
+    bench_checksum(iterations);
+    bench_parse_request(iterations);
+    bench_format_results(iterations);
+    return 0;
+}
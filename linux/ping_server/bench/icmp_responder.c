@@ -0,0 +1,220 @@
+/**
+ * @file icmp_responder.c
+ * @brief 用户态 ICMP Echo 应答器，按配置的延迟、抖动和丢包率回复，用于在本地网络命名空间中模拟目标主机群
+ *        需要关闭内核自身的 Echo 应答（net.ipv4.icmp_echo_ignore_all=1），见 netns.sh
+ */
+
+#include <poll.h>
+#include <time.h>
+
+#include "icmp_ping.h"
+
+#define RESPONDER_QUEUE_SIZE 16384 /**< 等待回复的最大报文数 */
+#define RESPONDER_PACKET_SIZE 128  /**< 可回复的最大报文长度，超出的 Echo 请求被忽略 */
+
+/**
+ * @brief 等待回复的报文
+ */
+struct pending_reply
+{
+    double due;                                   /**< 回复时间 */
+    int len;                                      /**< 报文长度（含 IP 头部） */
+    struct in_addr dst;                           /**< 回复目标 */
+    unsigned char packet[RESPONDER_PACKET_SIZE];  /**< 构造好的应答报文 */
+};
+
+static struct pending_reply queue[RESPONDER_QUEUE_SIZE]; // 按 due 排列的小根堆
+static int queue_len = 0;
+
+static volatile sig_atomic_t running = 1;
+static unsigned long received, lost, replied, overflowed;
+
+static void stop(int sig)
+{
+    (void)sig;
+    running = 0;
+}
+
+static void heap_push(const struct pending_reply *reply)
+{
+    int i = queue_len++;
+    while (i > 0 && queue[(i - 1) / 2].due > reply->due)
+    {
+        queue[i] = queue[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    queue[i] = *reply;
+}
+
+static void heap_pop()
+{
+    struct pending_reply last = queue[--queue_len];
+    int i = 0;
+    for (;;)
+    {
+        int child = 2 * i + 1;
+        if (child >= queue_len)
+        {
+            break;
+        }
+        if (child + 1 < queue_len && queue[child + 1].due < queue[child].due)
+        {
+            child++;
+        }
+        if (queue[child].due >= last.due)
+        {
+            break;
+        }
+        queue[i] = queue[child];
+        i = child;
+    }
+    if (queue_len > 0)
+    {
+        queue[i] = last;
+    }
+}
+
+/*
+ * 把收到的 Echo 请求构造成应答：交换源和目的地址，类型改为 Echo Reply 并重新计算校验和
+ */
+static int build_reply(const unsigned char *request, int bytes, struct pending_reply *reply)
+{
+    int ip_header_len = (request[0] & 0xf) << 2;
+    int icmp_len = bytes - ip_header_len;
+    if (icmp_len < 8 || 20 + icmp_len > RESPONDER_PACKET_SIZE || request[ip_header_len] != ICMP_ECHO)
+    {
+        return -1;
+    }
+
+    unsigned char *ip = reply->packet;
+    bzero(ip, 20);
+    ip[0] = 0x45;               // IPv4，头部20字节
+    uint16_t total_len = htons(20 + icmp_len);
+    memcpy(ip + 2, &total_len, 2);
+    ip[8] = 64;                 // TTL
+    ip[9] = IPPROTO_ICMP;
+    memcpy(ip + 12, request + 16, 4); // 源地址 = 请求的目的地址
+    memcpy(ip + 16, request + 12, 4); // 目的地址 = 请求的源地址
+
+    unsigned char *icmp = ip + 20;
+    memcpy(icmp, request + ip_header_len, icmp_len);
+    icmp[0] = ICMP_ECHOREPLY;
+    icmp[2] = icmp[3] = 0;
+    uint16_t checksum = htons(calculate_checksum(icmp, icmp_len));
+    memcpy(icmp + 2, &checksum, 2);
+
+    reply->len = 20 + icmp_len;
+    memcpy(&reply->dst, request + 12, 4);
+    return 0;
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr, "usage: %s [-d delay_ms] [-j jitter_ms] [-l loss_percent]\n", prog);
+}
+
+/**
+ * @brief 主函数
+ * @param argc 命令行参数个数
+ * @param argv 命令行参数列表
+ * @return 成功返回0，失败返回-1
+ */
+int main(int argc, char *argv[])
+{
+    double delay_ms = 0, jitter_ms = 0, loss_percent = 0;
+    int opt;
+    while ((opt = getopt(argc, argv, "d:j:l:")) != -1)
+    {
+        switch (opt)
+        {
+        case 'd':
+            delay_ms = atof(optarg);
+            break;
+        case 'j':
+            jitter_ms = atof(optarg);
+            break;
+        case 'l':
+            loss_percent = atof(optarg);
+            break;
+        default:
+            usage(argv[0]);
+            return -1;
+        }
+    }
+
+    // 接收用 ICMP 原始套接字，发送用 IPPROTO_RAW（自带 IP_HDRINCL），以便用被探测的地址作为源地址
+    int recv_sock = socket(AF_INET, SOCK_RAW, IPPROTO_ICMP);
+    int send_sock = socket(AF_INET, SOCK_RAW, IPPROTO_RAW);
+    if (recv_sock == -1 || send_sock == -1)
+    {
+        perror("create raw socket");
+        return -1;
+    }
+
+    signal(SIGINT, stop);
+    signal(SIGTERM, stop);
+    srand(time(NULL));
+    unsigned char buffer[IP_BUFFER_SIZE];
+
+    while (running)
+    {
+        // 发出所有到期的应答
+        double now = get_timestamp();
+        while (queue_len > 0 && queue[0].due <= now)
+        {
+            struct sockaddr_in addr;
+            bzero(&addr, sizeof(addr));
+            addr.sin_family = AF_INET;
+            addr.sin_addr = queue[0].dst;
+            if (sendto(send_sock, queue[0].packet, queue[0].len, 0, (struct sockaddr *)&addr, sizeof(addr)) != -1)
+            {
+                replied++;
+            }
+            heap_pop();
+        }
+
+        int timeout_ms = -1;
+        if (queue_len > 0)
+        {
+            timeout_ms = (int)((queue[0].due - now) * 1000) + 1;
+        }
+        struct pollfd pfd = {recv_sock, POLLIN, 0};
+        if (poll(&pfd, 1, timeout_ms) <= 0)
+        {
+            continue;
+        }
+
+        int bytes = recv(recv_sock, buffer, sizeof(buffer), MSG_DONTWAIT);
+        if (bytes <= 0)
+        {
+            continue;
+        }
+
+        struct pending_reply reply;
+        if (build_reply(buffer, bytes, &reply) != 0)
+        {
+            continue; // 不是 Echo 请求（例如自己发出的应答）
+        }
+        received++;
+
+        if (100.0 * rand() / RAND_MAX < loss_percent)
+        {
+            lost++;
+            continue;
+        }
+        if (queue_len >= RESPONDER_QUEUE_SIZE)
+        {
+            overflowed++;
+            continue;
+        }
+        double jitter = jitter_ms * (2.0 * rand() / RAND_MAX - 1.0);
+        double wait_ms = delay_ms + jitter > 0 ? delay_ms + jitter : 0;
+        reply.due = get_timestamp() + wait_ms / 1000;
+        heap_push(&reply);
+    }
+
+    printf("received:%lu\nlost:%lu\nreplied:%lu\noverflowed:%lu\n", received, lost, replied, overflowed);
+    close(recv_sock);
+    close(send_sock);
+    return 0;
+}
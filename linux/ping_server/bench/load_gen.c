@@ -0,0 +1,280 @@
+/**
+ * @file load_gen.c
+ * @brief HTTP 接口压测工具：按指定并发持续请求 ping_server，输出吞吐量、延迟分位数和服务端每个探测包的 CPU 开销
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <pthread.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+
+#define LOAD_MAX_CONCURRENCY 256   /**< 最大并发数 */
+#define LOAD_MAX_SAMPLES 1000000   /**< 最多记录的延迟样本数 */
+#define LOAD_RESPONSE_SIZE 65536   /**< 响应缓冲区大小 */
+
+/**
+ * @brief 压测参数
+ */
+struct load_config
+{
+    struct sockaddr_in addr; /**< 服务端地址 */
+    const char *path;        /**< 请求路径，如 /?ip=10.200.1.1&icmp_num=1 */
+    int concurrency;         /**< 并发数 */
+    double duration;         /**< 持续时间（秒） */
+    pid_t server_pid;        /**< 服务端进程号，用于统计 CPU，0 表示不统计 */
+};
+
+/**
+ * @brief 每个工作线程的统计
+ */
+struct load_worker
+{
+    pthread_t thread;
+    const struct load_config *config;
+    double *latencies; /**< 延迟样本（毫秒） */
+    long max_samples;
+    long requests;     /**< 成功的请求数 */
+    long errors;       /**< 失败的请求数 */
+    long probes;       /**< 响应中的探测结果行数 */
+    long probes_ok;    /**< status:ok 的行数 */
+};
+
+static double monotonic_now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/*
+ * 发送一个请求并读完响应，返回响应长度，失败返回-1
+ */
+static int do_request(const struct load_config *config, char *response, int size)
+{
+    int sock = socket(AF_INET, SOCK_STREAM, 0);
+    if (sock == -1)
+    {
+        return -1;
+    }
+    if (connect(sock, (const struct sockaddr *)&config->addr, sizeof(config->addr)) == -1)
+    {
+        close(sock);
+        return -1;
+    }
+
+    char request[512];
+    int len = snprintf(request, sizeof(request), "GET %s HTTP/1.1\r\nHost: bench\r\nConnection: close\r\n\r\n", config->path);
+    if (send(sock, request, len, 0) != len)
+    {
+        close(sock);
+        return -1;
+    }
+
+    // 服务端处理完即关闭连接，读到 EOF 为止
+    int offset = 0;
+    int bytes;
+    while (offset < size - 1 && (bytes = recv(sock, response + offset, size - 1 - offset, 0)) > 0)
+    {
+        offset += bytes;
+    }
+    close(sock);
+    response[offset] = '\0';
+    return strncmp(response, "HTTP/1.1 200", 12) == 0 ? offset : -1;
+}
+
+static void *worker_main(void *arg)
+{
+    struct load_worker *worker = arg;
+    char *response = malloc(LOAD_RESPONSE_SIZE);
+    double deadline = monotonic_now() + worker->config->duration;
+
+    while (monotonic_now() < deadline)
+    {
+        double start = monotonic_now();
+        if (do_request(worker->config, response, LOAD_RESPONSE_SIZE) < 0)
+        {
+            worker->errors++;
+            continue;
+        }
+        double elapsed_ms = (monotonic_now() - start) * 1000;
+
+        if (worker->requests < worker->max_samples)
+        {
+            worker->latencies[worker->requests] = elapsed_ms;
+        }
+        worker->requests++;
+
+        // 每个探测结果一行，以 "seq:" 字段计数
+        for (const char *p = strstr(response, "seq:"); p != NULL; p = strstr(p + 4, "seq:"))
+        {
+            worker->probes++;
+        }
+        for (const char *p = strstr(response, "status:ok"); p != NULL; p = strstr(p + 9, "status:ok"))
+        {
+            worker->probes_ok++;
+        }
+    }
+
+    free(response);
+    return NULL;
+}
+
+/*
+ * 读取进程累计的 CPU 时间（秒），失败返回-1
+ */
+static double process_cpu_seconds(pid_t pid)
+{
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/%d/stat", pid);
+    FILE *fp = fopen(path, "r");
+    if (fp == NULL)
+    {
+        return -1;
+    }
+
+    // 第2个字段 comm 可能含空格，从最后一个 ')' 之后开始解析，utime/stime 为第14、15个字段
+    char line[1024];
+    double seconds = -1;
+    if (fgets(line, sizeof(line), fp) != NULL)
+    {
+        char *p = strrchr(line, ')');
+        unsigned long utime, stime;
+        if (p != NULL && sscanf(p + 2, "%*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %lu %lu", &utime, &stime) == 2)
+        {
+            seconds = (double)(utime + stime) / sysconf(_SC_CLK_TCK);
+        }
+    }
+    fclose(fp);
+    return seconds;
+}
+
+static int compare_double(const void *a, const void *b)
+{
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return x < y ? -1 : x > y;
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr, "usage: %s [-h host] [-p port] [-c concurrency] [-d seconds] [-P server_pid] [-u path]\n", prog);
+}
+
+/**
+ * @brief 主函数
+ * @param argc 命令行参数个数
+ * @param argv 命令行参数列表
+ * @return 成功返回0，失败返回-1
+ */
+int main(int argc, char *argv[])
+{
+    struct load_config config;
+    bzero(&config, sizeof(config));
+    config.addr.sin_family = AF_INET;
+    config.addr.sin_port = htons(8080);
+    inet_aton("127.0.0.1", &config.addr.sin_addr);
+    config.path = "/?ip=127.0.0.1&icmp_num=1";
+    config.concurrency = 4;
+    config.duration = 10;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "h:p:c:d:P:u:")) != -1)
+    {
+        switch (opt)
+        {
+        case 'h':
+            if (inet_aton(optarg, &config.addr.sin_addr) == 0)
+            {
+                fprintf(stderr, "bad ip address: %s\n", optarg);
+                return -1;
+            }
+            break;
+        case 'p':
+            config.addr.sin_port = htons(atoi(optarg));
+            break;
+        case 'c':
+            config.concurrency = atoi(optarg);
+            break;
+        case 'd':
+            config.duration = atof(optarg);
+            break;
+        case 'P':
+            config.server_pid = atoi(optarg);
+            break;
+        case 'u':
+            config.path = optarg;
+            break;
+        default:
+            usage(argv[0]);
+            return -1;
+        }
+    }
+    if (config.concurrency <= 0 || config.concurrency > LOAD_MAX_CONCURRENCY || config.duration <= 0)
+    {
+        usage(argv[0]);
+        return -1;
+    }
+
+    static struct load_worker workers[LOAD_MAX_CONCURRENCY];
+    double *latencies = malloc(sizeof(double) * LOAD_MAX_SAMPLES);
+    if (latencies == NULL)
+    {
+        perror("allocate samples");
+        return -1;
+    }
+    long per_worker = LOAD_MAX_SAMPLES / config.concurrency;
+
+    double cpu_start = config.server_pid > 0 ? process_cpu_seconds(config.server_pid) : -1;
+    double start = monotonic_now();
+    for (int i = 0; i < config.concurrency; i++)
+    {
+        workers[i].config = &config;
+        workers[i].latencies = latencies + i * per_worker;
+        workers[i].max_samples = per_worker;
+        pthread_create(&workers[i].thread, NULL, worker_main, &workers[i]);
+    }
+
+    // 汇总：把各线程的样本压紧到数组前部
+    long requests = 0, errors = 0, probes = 0, probes_ok = 0, samples = 0;
+    for (int i = 0; i < config.concurrency; i++)
+    {
+        pthread_join(workers[i].thread, NULL);
+        long n = workers[i].requests < per_worker ? workers[i].requests : per_worker;
+        memmove(latencies + samples, workers[i].latencies, sizeof(double) * n);
+        samples += n;
+        requests += workers[i].requests;
+        errors += workers[i].errors;
+        probes += workers[i].probes;
+        probes_ok += workers[i].probes_ok;
+    }
+    double elapsed = monotonic_now() - start;
+    double cpu_end = config.server_pid > 0 ? process_cpu_seconds(config.server_pid) : -1;
+
+    qsort(latencies, samples, sizeof(double), compare_double);
+    printf("duration:%.2fs\n", elapsed);
+    printf("concurrency:%d\n", config.concurrency);
+    printf("requests:%ld\n", requests);
+    printf("errors:%ld\n", errors);
+    printf("probes:%ld\n", probes);
+    printf("probes_ok:%ld\n", probes_ok);
+    printf("throughput:%.1f req/s\n", requests / elapsed);
+    printf("probe_rate:%.1f probe/s\n", probes / elapsed);
+    if (samples > 0)
+    {
+        printf("latency_p50:%.2fms\n", latencies[samples / 2]);
+        printf("latency_p99:%.2fms\n", latencies[(long)(samples * 0.99)]);
+        printf("latency_max:%.2fms\n", latencies[samples - 1]);
+    }
+    if (cpu_start >= 0 && cpu_end >= 0 && probes > 0)
+    {
+        printf("server_cpu:%.3fs\n", cpu_end - cpu_start);
+        printf("server_cpu_per_probe:%.1fus\n", (cpu_end - cpu_start) * 1e6 / probes);
+    }
+
+    free(latencies);
+    return 0;
+}
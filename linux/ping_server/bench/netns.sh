@@ -0,0 +1,36 @@
+#!/usr/bin/env bash
+# 创建/删除压测用的网络命名空间：
+#   主机 10.200.0.1 <-veth-> 10.200.0.2 命名空间
+#   10.201.0.0/16 整段路由到命名空间内并作为本地地址，模拟 65536 个目标主机
+#   命名空间内关闭内核 Echo 应答，由 icmp_responder 按配置的延迟和丢包率回复
+
+NS=dial_bench
+FLEET=10.201.0.0/16
+
+case "$1" in
+up)
+    ip netns add $NS || exit 1
+    ip link add dial0 type veth peer name dial1
+    ip link set dial1 netns $NS
+    ip addr add 10.200.0.1/30 dev dial0
+    ip link set dial0 up
+    ip route add $FLEET via 10.200.0.2
+
+    ip netns exec $NS ip addr add 10.200.0.2/30 dev dial1
+    ip netns exec $NS ip link set dial1 up
+    ip netns exec $NS ip link set lo up
+    ip netns exec $NS ip route add local $FLEET dev lo
+    ip netns exec $NS sysctl -qw net.ipv4.icmp_echo_ignore_all=1
+    echo "namespace $NS up, targets $FLEET"
+    ;;
+down)
+    ip route del $FLEET 2>/dev/null
+    ip link del dial0 2>/dev/null
+    ip netns del $NS 2>/dev/null
+    echo "namespace $NS down"
+    ;;
+*)
+    echo "用法: $0 up|down"
+    exit 1
+    ;;
+esac
@@ -0,0 +1,55 @@
+#!/usr/bin/env bash
+# 一键压测：微基准 + 在本地网络命名空间中模拟目标主机群，对 HTTP 接口做端到端压测
+# 用法: run_bench.sh <build_dir> [concurrency] [seconds] [delay_ms] [loss_percent]
+# 需要 root 权限；安装了 strace 时额外统计每个探测包的系统调用次数
+
+BUILD=${1:?"用法: $0 <build_dir> [concurrency] [seconds] [delay_ms] [loss_percent]"}
+CONCURRENCY=${2:-4}
+SECONDS_=${3:-10}
+DELAY_MS=${4:-20}
+LOSS=${5:-1}
+DIR=$(cd "$(dirname "$0")" && pwd)
+
+echo "== microbenchmarks =="
+"$BUILD/bench_micro" || exit 1
+
+cleanup() {
+    [ -n "$SERVER_PID" ] && kill "$SERVER_PID" 2>/dev/null
+    [ -n "$RESPONDER_PID" ] && kill "$RESPONDER_PID" 2>/dev/null
+    wait 2>/dev/null
+    "$DIR/netns.sh" down >/dev/null
+}
+trap cleanup EXIT
+
+"$DIR/netns.sh" up || exit 1
+ip netns exec dial_bench "$BUILD/icmp_responder" -d "$DELAY_MS" -l "$LOSS" &
+RESPONDER_PID=$!
+
+"$BUILD/ping_server" >/dev/null &
+SERVER_PID=$!
+sleep 0.5
+
+STRACE_LOG=$(mktemp)
+if command -v strace >/dev/null; then
+    strace -c -f -o "$STRACE_LOG" -p "$SERVER_PID" &
+    STRACE_PID=$!
+    sleep 0.5
+fi
+
+echo "== load: concurrency=$CONCURRENCY duration=${SECONDS_}s delay=${DELAY_MS}ms loss=${LOSS}% =="
+RESULT=$("$BUILD/load_gen" -c "$CONCURRENCY" -d "$SECONDS_" -P "$SERVER_PID" -u "/?ip=10.201.0.1&icmp_num=1")
+echo "$RESULT"
+
+if [ -n "$STRACE_PID" ]; then
+    kill -INT "$STRACE_PID"
+    wait "$STRACE_PID" 2>/dev/null
+    PROBES=$(echo "$RESULT" | sed -n 's/^probes://p')
+    CALLS=$(awk '$NF == "total" {print $4}' "$STRACE_LOG")
+    if [ -n "$CALLS" ] && [ "${PROBES:-0}" -gt 0 ]; then
+        echo "server_syscalls:$CALLS"
+        echo "server_syscalls_per_probe:$(awk -v c="$CALLS" -v p="$PROBES" 'BEGIN {printf "%.1f", c / p}')"
+    fi
+else
+    echo "server_syscalls_per_probe:n/a (strace not installed)"
+fi
+rm -f "$STRACE_LOG"
@@ -0,0 +1,213 @@
+#include <ctype.h>
+
+#include "config.h"
+#include "http_server.h"
+
+void config_defaults(struct server_config *config)
+{
+    bzero(config, sizeof(*config));
+    config->port = PORT;
+    config->max_connections = MAX_CONNECTIONS;
+    config->max_results = MAX_RESULTS;
+    config->recv_timeout_usec = RECV_TIMEOUT_USEC;
+    config->ping_interval_ms = 1000;
+    snprintf(config->magic, sizeof(config->magic), "%s", MAGIC);
+    config->default_interval_ms = CONFIG_DEFAULT_INTERVAL_MS;
+}
+
+static int compare_target(const void *a, const void *b)
+{
+    const struct config_target *x = a;
+    const struct config_target *y = b;
+    if (x->addr != y->addr)
+    {
+        return x->addr < y->addr ? -1 : 1;
+    }
+    return x->interval_ms < y->interval_ms ? -1 : x->interval_ms > y->interval_ms;
+}
+
+/*
+ * 去掉首尾空白，返回新的起始位置
+ */
+static char *trim(char *s)
+{
+    while (isspace((unsigned char)*s))
+    {
+        s++;
+    }
+    char *end = s + strlen(s);
+    while (end > s && isspace((unsigned char)end[-1]))
+    {
+        *--end = '\0';
+    }
+    return s;
+}
+
+/*
+ * 解析整数配置项，超出范围返回-1
+ */
+static int parse_int(const char *value, int min, int max, int *out)
+{
+    char *end;
+    long n = strtol(value, &end, 10);
+    if (end == value || *end != '\0' || n < min || n > max)
+    {
+        return -1;
+    }
+    *out = (int)n;
+    return 0;
+}
+
+/*
+ * 解析 "ip [interval_ms]"，追加到目标列表
+ */
+static int parse_target(char *value, struct server_config *config, int *capacity)
+{
+    char *interval = value + strcspn(value, " \t");
+    if (*interval != '\0')
+    {
+        *interval++ = '\0';
+        interval = trim(interval);
+    }
+
+    struct in_addr addr;
+    if (inet_aton(value, &addr) == 0)
+    {
+        return -1;
+    }
+    int interval_ms = 0; // 未指定时读完文件后再填入 default_interval_ms
+    if (*interval != '\0' && parse_int(interval, CONFIG_MIN_INTERVAL_MS, 86400000, &interval_ms) != 0)
+    {
+        return -1;
+    }
+
+    if (config->targets_len == *capacity)
+    {
+        int grown_capacity = *capacity == 0 ? 1024 : *capacity * 2;
+        struct config_target *grown = realloc(config->targets, sizeof(struct config_target) * grown_capacity);
+        if (grown == NULL)
+        {
+            perror("allocate targets");
+            return -1;
+        }
+        config->targets = grown;
+        *capacity = grown_capacity;
+    }
+    config->targets[config->targets_len].addr = ntohl(addr.s_addr);
+    config->targets[config->targets_len].interval_ms = interval_ms;
+    config->targets_len++;
+    return 0;
+}
+
+int config_load(const char *path, struct server_config *out)
+{
+    FILE *fp = fopen(path, "r");
+    if (fp == NULL)
+    {
+        return -1;
+    }
+
+    struct server_config config;
+    config_defaults(&config);
+    int capacity = 0;
+    int line_no = 0;
+    int ret = 0;
+    char line[256];
+
+    while (ret == 0 && fgets(line, sizeof(line), fp) != NULL)
+    {
+        line_no++;
+        line[strcspn(line, "#\r\n")] = '\0';
+        char *key = trim(line);
+        if (*key == '\0')
+        {
+            continue;
+        }
+
+        char *eq = strchr(key, '=');
+        if (eq == NULL)
+        {
+            ret = -1;
+            break;
+        }
+        *eq = '\0';
+        char *value = trim(eq + 1);
+        key = trim(key);
+
+        if (strcmp(key, "target") == 0)
+        {
+            ret = parse_target(value, &config, &capacity);
+        }
+        else if (strcmp(key, "port") == 0)
+        {
+            ret = parse_int(value, 1, 65535, &config.port);
+        }
+        else if (strcmp(key, "max_connections") == 0)
+        {
+            ret = parse_int(value, 1, 65535, &config.max_connections);
+        }
+        else if (strcmp(key, "max_results") == 0)
+        {
+            ret = parse_int(value, 1, MAX_RESULTS, &config.max_results);
+        }
+        else if (strcmp(key, "recv_timeout_usec") == 0)
+        {
+            ret = parse_int(value, 1000, 999999, &config.recv_timeout_usec);
+        }
+        else if (strcmp(key, "ping_interval_ms") == 0)
+        {
+            ret = parse_int(value, CONFIG_MIN_INTERVAL_MS, 60000, &config.ping_interval_ms);
+        }
+        else if (strcmp(key, "default_interval_ms") == 0)
+        {
+            ret = parse_int(value, CONFIG_MIN_INTERVAL_MS, 86400000, &config.default_interval_ms);
+        }
+        else if (strcmp(key, "magic") == 0 && strlen(value) < MAGIC_LEN)
+        {
+            bzero(config.magic, sizeof(config.magic));
+            strcpy(config.magic, value);
+        }
+        else
+        {
+            ret = -1;
+        }
+    }
+    fclose(fp);
+
+    if (ret != 0)
+    {
+        fprintf(stderr, "%s:%d: bad config line\n", path, line_no);
+        config_free(&config);
+        return -1;
+    }
+
+    for (int i = 0; i < config.targets_len; i++)
+    {
+        if (config.targets[i].interval_ms == 0)
+        {
+            config.targets[i].interval_ms = config.default_interval_ms;
+        }
+    }
+
+    // 按地址排序，重复的目标保留间隔最短的一项
+    qsort(config.targets, config.targets_len, sizeof(struct config_target), compare_target);
+    int unique = 0;
+    for (int i = 0; i < config.targets_len; i++)
+    {
+        if (unique == 0 || config.targets[unique - 1].addr != config.targets[i].addr)
+        {
+            config.targets[unique++] = config.targets[i];
+        }
+    }
+    config.targets_len = unique;
+
+    *out = config;
+    return 0;
+}
+
+void config_free(struct server_config *config)
+{
+    free(config->targets);
+    config->targets = NULL;
+    config->targets_len = 0;
+}
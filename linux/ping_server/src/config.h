@@ -0,0 +1,59 @@
+#ifndef CONFIG_H
+#define CONFIG_H
+
+#include <stdint.h>
+
+#include "icmp_ping.h"
+
+#define CONFIG_DEFAULT_PATH "/etc/ping_server.conf" /**< 默认配置文件路径 */
+#define CONFIG_CHECK_INTERVAL_SEC 1                 /**< 检查配置文件是否修改的间隔（秒） */
+#define CONFIG_DEFAULT_INTERVAL_MS 1000             /**< 持续探测目标的默认间隔（毫秒） */
+#define CONFIG_MIN_INTERVAL_MS 10                   /**< 持续探测目标的最小间隔（毫秒） */
+
+/**
+ * @brief 持续探测的目标
+ */
+struct config_target
+{
+    uint32_t addr;        /**< 目标地址（主机字节序，便于排序） */
+    uint32_t interval_ms; /**< 探测间隔（毫秒） */
+};
+
+/**
+ * @brief 运行时配置，未在配置文件中出现的项使用编译时的默认值
+ */
+struct server_config
+{
+    int port;                     /**< 监听端口 */
+    int max_connections;          /**< listen 队列长度 */
+    int max_results;              /**< 单个请求的最大 icmp_num，不超过 MAX_RESULTS */
+    int recv_timeout_usec;        /**< ping 的接收超时（微秒） */
+    int ping_interval_ms;         /**< ping 两个包之间的间隔（毫秒） */
+    char magic[MAGIC_LEN];        /**< Echo 请求的魔术字符串 */
+    int default_interval_ms;      /**< 持续探测目标的默认间隔（毫秒） */
+    struct config_target *targets; /**< 持续探测目标，按地址排序且去重 */
+    int targets_len;              /**< 目标个数 */
+};
+
+/**
+ * @brief 使用编译时的默认值初始化配置
+ * @param config 配置
+ */
+void config_defaults(struct server_config *config);
+
+/**
+ * @brief 读取配置文件。格式为每行一项 "key = value"，# 开头为注释；
+ *        "target = ip [interval_ms]" 可重复出现，列出持续探测的目标
+ * @param path 配置文件路径
+ * @param config 读取结果，失败时不修改
+ * @return 成功返回0，失败返回-1
+ */
+int config_load(const char *path, struct server_config *config);
+
+/**
+ * @brief 释放配置中分配的目标列表
+ * @param config 配置
+ */
+void config_free(struct server_config *config);
+
+#endif /* CONFIG_H */
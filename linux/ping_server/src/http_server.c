@@ -1,5 +1,20 @@
+#include <sys/uio.h>
+
 #include "http_server.h"
 
+static struct object_pool conn_pool; // 连接对象
+static int max_results = MAX_RESULTS; // 单个请求的最大 icmp_num，可由配置文件修改
+
+int http_server_init()
+{
+    return pool_init(&conn_pool, "http_conn", sizeof(struct http_conn), MAX_CONNECTIONS);
+}
+
+void http_server_set_max_results(int value)
+{
+    max_results = value > 0 && value < MAX_RESULTS ? value : MAX_RESULTS;
+}
+
 int parse_request(const char *request, char *ip, int *icmp_num)
 {
     // 解析请求，假设只处理 GET 请求，比较前3个字符是否相等
@@ -34,71 +49,365 @@ int parse_request(const char *request, char *ip, int *icmp_num)
     return 200; // OK
 }
 
-void handle_client(int client_socket)
+int parse_traceroute_request(const char *request, char *ip, int *max_hops)
 {
-    char request[1024];
-    int bytes_received = recv(client_socket, request, sizeof(request), 0);
-    if (bytes_received < 0)
+    const char *ip_start = strstr(request, "ip=");
+    if (ip_start == NULL)
     {
-        perror("Failed to receive data from client");
-        close(client_socket);
+        return 400; // Bad Request
+    }
+    ip_start += 3; // 跳过 "ip="
+
+    int i;
+    for (i = 0; i < 15; i++)
+    {
+        if (ip_start[i] == '&' || ip_start[i] == ' ' || ip_start[i] == '\r' || ip_start[i] == '\n' || ip_start[i] == '\0')
+        {
+            break;
+        }
+        ip[i] = ip_start[i];
+    }
+    ip[i] = '\0';
+
+    *max_hops = TRACE_MAX_HOPS;
+    const char *max_hops_start = strstr(request, "max_hops=");
+    if (max_hops_start != NULL)
+    {
+        *max_hops = atoi(max_hops_start + 9); // 跳过 "max_hops="
+    }
+    if (*max_hops <= 0 || *max_hops > TRACE_MAX_HOPS)
+    {
+        return 400; // Bad Request
+    }
+
+    return 200; // OK
+}
+
+int parse_targets_request(const char *request, int *offset, int *limit)
+{
+    *offset = 0;
+    *limit = TARGETS_DEFAULT_LIMIT;
+
+    // 只在请求行中查找参数
+    const char *line_end = strstr(request, "\r\n");
+    const char *offset_start = strstr(request, "offset=");
+    if (offset_start != NULL && (line_end == NULL || offset_start < line_end))
+    {
+        *offset = atoi(offset_start + 7); // 跳过 "offset="
+    }
+    const char *limit_start = strstr(request, "limit=");
+    if (limit_start != NULL && (line_end == NULL || limit_start < line_end))
+    {
+        *limit = atoi(limit_start + 6); // 跳过 "limit="
+    }
+    if (*offset < 0 || *limit <= 0 || *limit > TARGETS_MAX_LIMIT)
+    {
+        return 400; // Bad Request
+    }
+
+    return 200; // OK
+}
+
+int format_ping_results(char *buffer, int size, const struct ping_result *results, int count)
+{
+    int offset = 0;
+    for (int i = 0; i < count; i++)
+    {
+        int n = snprintf(buffer + offset, size - offset, "ipv4_source:%s,ipv4_target:%s,ipv6_target:%s,seq:%d,time:%.2fms,status:%s,reporter:%s\n", results[i].ipv4_source, results[i].ipv4_target, results[i].ipv6_target, results[i].seq, results[i].time, ping_status_str(results[i].status), results[i].ipv4_reporter);
+        if (n >= size - offset)
+        {
+            break; // 缓冲区不足，丢弃不完整的行
+        }
+        offset += n;
+    }
+    return offset;
+}
+
+/*
+ * 发送只有状态行的响应
+ */
+static void send_status(struct http_conn *conn, int status)
+{
+    const char *reason = "Bad Request";
+    if (status == 500)
+    {
+        reason = "Internal Server Error";
+    }
+    else if (status == 501)
+    {
+        reason = "Not Implemented";
+    }
+    else if (status == 503)
+    {
+        reason = "Service Unavailable";
+    }
+
+    char response[128];
+    int len = snprintf(response, sizeof(response), "HTTP/1.1 %d %s\r\nContent-Length: 0\r\n\r\n", status, reason);
+    send(conn->socket, response, len, 0);
+}
+
+/*
+ * 发送 200 响应，头部和正文通过 writev 一次发出，正文不再拷贝
+ */
+static void send_body(struct http_conn *conn, const char *body, int body_len)
+{
+    char header[128];
+    int header_len = snprintf(header, sizeof(header), "HTTP/1.1 200 OK\r\nContent-Type: text/plain\r\nContent-Length: %d\r\n\r\n", body_len);
+
+    struct iovec iov[2];
+    iov[0].iov_base = header;
+    iov[0].iov_len = header_len;
+    iov[1].iov_base = (void *)body;
+    iov[1].iov_len = body_len;
+    if (writev(conn->socket, iov, 2) == -1)
+    {
+        perror("Failed to send response");
+    }
+}
+
+/*
+ * 处理路由追踪请求，每一跳输出一行
+ */
+static void handle_traceroute(struct http_conn *conn)
+{
+    char ip[16];
+    int max_hops;
+    if (parse_traceroute_request(conn->request, ip, &max_hops) != 200)
+    {
+        send_status(conn, 400);
+        return;
+    }
+
+    struct hop_result *hops = arena_alloc(&conn->arena, sizeof(struct hop_result) * TRACE_MAX_HOPS);
+    char *response_body = arena_alloc(&conn->arena, TRACE_BUFFER_SIZE);
+    int hop_count = 0;
+    if (hops == NULL || response_body == NULL || traceroute(ip, max_hops, hops, &hop_count) != 0)
+    {
+        send_status(conn, 500);
         return;
     }
 
+    int response_body_offset = 0;
+    for (int i = 0; i < hop_count; i++)
+    {
+        struct hop_result *hop = &hops[i];
+        int n = snprintf(response_body + response_body_offset, TRACE_BUFFER_SIZE - response_body_offset, "ttl:%d,hop:%s,sent:%d,received:%d,loss:%.1f%%,min:%.2fms,avg:%.2fms,max:%.2fms\n", hop->ttl, hop->ipv4_hop, hop->sent, hop->received, hop->sent > 0 ? 100.0 * (hop->sent - hop->received) / hop->sent : 100.0, hop->min, hop->avg, hop->max);
+        if (n >= TRACE_BUFFER_SIZE - response_body_offset)
+        {
+            break;
+        }
+        response_body_offset += n;
+    }
+
+    send_body(conn, response_body, response_body_offset);
+}
+
+/*
+ * 输出运行统计，每项一行 name:value
+ */
+static void handle_stats(struct http_conn *conn)
+{
+    char *response_body = arena_alloc(&conn->arena, STATS_BUFFER_SIZE);
+    if (response_body == NULL)
+    {
+        send_status(conn, 500);
+        return;
+    }
+
+    struct pacer_stats pacer;
+    pacer_get_stats(&pacer);
+    int offset = snprintf(response_body, STATS_BUFFER_SIZE,
+                          "pacer_sent:%llu\npacer_delayed:%llu\npacer_dropped:%llu\npacer_backlog:%.1f\n",
+                          (unsigned long long)pacer.sent, (unsigned long long)pacer.delayed,
+                          (unsigned long long)pacer.dropped, pacer.backlog);
+
+    // 对象池：容量、正在使用、峰值、分配次数、耗尽次数
+    for (int i = 0; i < pool_count() && offset < STATS_BUFFER_SIZE; i++)
+    {
+        const struct object_pool *pool = pool_get(i);
+        offset += snprintf(response_body + offset, STATS_BUFFER_SIZE - offset,
+                           "pool_%s_capacity:%d\npool_%s_in_use:%d\npool_%s_peak:%d\npool_%s_allocs:%llu\npool_%s_failures:%llu\n",
+                           pool->name, pool->capacity, pool->name, pool->in_use, pool->name, pool->peak,
+                           pool->name, (unsigned long long)pool->allocs, pool->name, (unsigned long long)pool->failures);
+    }
+
+    struct icmp_filter_stats filter;
+    icmp_filter_get_stats(&filter);
+    if (offset < STATS_BUFFER_SIZE)
+    {
+        offset += snprintf(response_body + offset, STATS_BUFFER_SIZE - offset,
+                           "icmp_filter_ident_lo:%u\nicmp_filter_ident_hi:%u\nicmp_filter_attached:%llu\nicmp_filter_delivered:%llu\nicmp_filter_host_undelivered_est:%llu\n",
+                           filter.ident_lo, filter.ident_hi, (unsigned long long)filter.attached,
+                           (unsigned long long)filter.delivered, (unsigned long long)filter.undelivered);
+    }
+
+    struct arena_stats arena;
+    arena_get_stats(&arena);
+    if (offset < STATS_BUFFER_SIZE)
+    {
+        offset += snprintf(response_body + offset, STATS_BUFFER_SIZE - offset, "arena_size:%d\narena_peak:%zu\narena_failures:%llu\n",
+                           REQUEST_ARENA_SIZE, arena.peak, (unsigned long long)arena.failures);
+    }
+
+    // 持续探测：目标数、最近一次重新加载的变化和耗时、累计结果
+    struct scheduler_stats sched;
+    scheduler_get_stats(&sched);
+    if (offset < STATS_BUFFER_SIZE)
+    {
+        offset += snprintf(response_body + offset, STATS_BUFFER_SIZE - offset,
+                           "scheduler_targets:%d\nscheduler_reloads:%llu\nscheduler_last_apply_ms:%.3f\nscheduler_last_added:%d\nscheduler_last_removed:%d\nscheduler_last_changed:%d\n"
+                           "scheduler_sent:%llu\nscheduler_received:%llu\nscheduler_errors:%llu\nscheduler_timeouts:%llu\nscheduler_dropped:%llu\n",
+                           sched.targets, (unsigned long long)sched.reloads, sched.last_apply_ms, sched.last_added,
+                           sched.last_removed, sched.last_changed, (unsigned long long)sched.sent,
+                           (unsigned long long)sched.received, (unsigned long long)sched.errors,
+                           (unsigned long long)sched.timeouts, (unsigned long long)sched.dropped);
+    }
+    if (offset > STATS_BUFFER_SIZE - 1)
+    {
+        offset = STATS_BUFFER_SIZE - 1;
+    }
+
+    send_body(conn, response_body, offset);
+}
+
+/*
+ * 输出持续探测目标的状态，每个目标一行：最近一次结果和最近 SCHEDULER_HISTORY 次的平均往返时间
+ */
+static void handle_targets(struct http_conn *conn)
+{
+    int offset, limit;
+    int status = parse_targets_request(conn->request, &offset, &limit);
+    if (status != 200)
+    {
+        send_status(conn, status);
+        return;
+    }
+
+    int response_body_size = limit * TARGET_LINE_SIZE;
+    char *response_body = arena_alloc(&conn->arena, response_body_size);
+    if (response_body == NULL)
+    {
+        send_status(conn, 500);
+        return;
+    }
+
+    int response_body_offset = 0;
+    const struct sched_target *target;
+    for (int i = offset; i < offset + limit && (target = scheduler_target_at(i)) != NULL; i++)
+    {
+        const char *last_status = "none";
+        double last_time = 0;
+        double sum = 0;
+        int replies = 0;
+        if (target->history_len > 0)
+        {
+            const struct probe_record *last = &target->history[(target->history_pos + SCHEDULER_HISTORY - 1) % SCHEDULER_HISTORY];
+            last_status = ping_status_str(last->status);
+            last_time = last->time;
+        }
+        for (int j = 0; j < target->history_len; j++)
+        {
+            if (target->history[j].status == PING_STATUS_OK)
+            {
+                sum += target->history[j].time;
+                replies++;
+            }
+        }
+        uint64_t answered = target->sent - target->pending; // 等待中的探测不计入丢包
+        double loss = answered > 0 ? 100.0 * (answered - target->received) / answered : 0;
+
+        char ip[IPV4_LEN];
+        inet_ntop(AF_INET, &target->addr, ip, sizeof(ip));
+        int n = snprintf(response_body + response_body_offset, response_body_size - response_body_offset,
+                         "ipv4_target:%s,interval:%ums,sent:%llu,received:%llu,loss:%.1f%%,status:%s,time:%.2fms,avg:%.2fms\n",
+                         ip, target->interval_ms, (unsigned long long)target->sent, (unsigned long long)target->received,
+                         loss, last_status, last_time, replies > 0 ? sum / replies : 0);
+        if (n >= response_body_size - response_body_offset)
+        {
+            break; // 缓冲区不足，丢弃不完整的行
+        }
+        response_body_offset += n;
+    }
+
+    send_body(conn, response_body, response_body_offset);
+}
+
+/*
+ * 处理 ping 请求，每个结果一行
+ */
+static void handle_ping(struct http_conn *conn)
+{
     char ip[16]; // IPv4
     int icmp_num;
 
-    int status = parse_request(request, ip, &icmp_num);
+    int status = parse_request(conn->request, ip, &icmp_num);
     if (status != 200)
     {
-        char response[1024];
-        snprintf(response, sizeof(response), "HTTP/1.1 %d %s\r\nContent-Length: 0\r\n\r\n", status, (status == 501 ? "Not Implemented" : "Bad Request"));
-        send(client_socket, response, strlen(response), 0);
-        close(client_socket);
+        send_status(conn, status);
         return;
     }
 
-    if (icmp_num <= 0 || icmp_num > MAX_RESULTS)
+    if (icmp_num <= 0 || icmp_num > max_results)
     {
-        char response[] = "HTTP/1.1 400 Bad Request\r\nContent-Length: 0\r\n\r\n";
-        send(client_socket, response, strlen(response), 0);
-        close(client_socket);
+        send_status(conn, 400);
         return;
     }
 
-    // 调用 ping 函数获取结果
-    struct ping_result results[MAX_RESULTS];
-    int ping_result_flag = ping(ip, icmp_num, results);
-    if (ping_result_flag != 0)
+    // 结果和响应正文都从请求 arena 分配，请求结束时一次性释放
+    struct ping_result *results = arena_alloc(&conn->arena, sizeof(struct ping_result) * icmp_num);
+    int response_body_size = icmp_num * RESULT_LINE_SIZE;
+    char *response_body = arena_alloc(&conn->arena, response_body_size);
+    if (results == NULL || response_body == NULL || ping(ip, icmp_num, results) != 0)
     {
-        char response[] = "HTTP/1.1 500 Internal Server Error\r\nContent-Length: 0\r\n\r\n";
-        send(client_socket, response, strlen(response), 0);
-        close(client_socket);
+        send_status(conn, 500);
         return;
     }
 
-    // 构建响应头部
-    char response[BUFFER_SIZE];
-    int offset = snprintf(response, sizeof(response), "HTTP/1.1 200 OK\r\n");
-    offset += snprintf(response + offset, sizeof(response) - offset, "Content-Type: text/plain\r\n");
+    int response_body_offset = format_ping_results(response_body, response_body_size, results, icmp_num);
+    send_body(conn, response_body, response_body_offset);
+}
 
-    // 构建响应正文
-    char response_body[BUFFER_SIZE - offset]; // 剩余空间用于响应正文
-    int response_body_offset = 0;
-    for (int i = 0; i < icmp_num; i++)
+void handle_client(int client_socket)
+{
+    struct http_conn *conn = pool_alloc(&conn_pool);
+    if (conn == NULL)
     {
-        response_body_offset += snprintf(response_body + response_body_offset, sizeof(response_body) - response_body_offset, "ipv4_source:%s,ipv4_target:%s,ipv6_target:%s,seq:%d,time:%.2fms\n", results[i].ipv4_source, results[i].ipv4_target, results[i].ipv6_target, results[i].seq, results[i].time);
+        char response[] = "HTTP/1.1 503 Service Unavailable\r\nContent-Length: 0\r\n\r\n";
+        send(client_socket, response, strlen(response), 0);
+        close(client_socket);
+        return;
     }
+    conn->socket = client_socket;
+    arena_init(&conn->arena, conn->arena_memory, sizeof(conn->arena_memory));
 
-    // 构建 Content-Length 头部
-    int content_length = response_body_offset;
-    offset += snprintf(response + offset, sizeof(response) - offset, "Content-Length: %d\r\n\r\n", content_length);
-
-    // 将响应头部和响应正文拼接在一起
-    memcpy(response + offset, response_body, response_body_offset);
-    offset += response_body_offset;
+    int bytes_received = recv(client_socket, conn->request, sizeof(conn->request) - 1, 0);
+    if (bytes_received < 0)
+    {
+        perror("Failed to receive data from client");
+    }
+    else
+    {
+        conn->request[bytes_received] = '\0';
+        if (strncmp(conn->request, "GET /traceroute", 15) == 0)
+        {
+            handle_traceroute(conn);
+        }
+        else if (strncmp(conn->request, "GET /stats", 10) == 0)
+        {
+            handle_stats(conn);
+        }
+        else if (strncmp(conn->request, "GET /targets", 12) == 0)
+        {
+            handle_targets(conn);
+        }
+        else
+        {
+            handle_ping(conn);
+        }
+    }
 
-    // 发送响应给客户端
-    send(client_socket, response, offset, 0);
+    arena_reset(&conn->arena);
+    pool_free(&conn_pool, conn);
     close(client_socket);
 }
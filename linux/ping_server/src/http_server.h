@@ -2,16 +2,53 @@
 #define HTTP_SERVER_H
 
 #include "icmp_ping.h"
+#include "traceroute.h"
+#include "pool.h"
+#include "scheduler.h"
 
 #define PORT 8080
 #define MAX_CONNECTIONS 10
 #define MAX_RESULTS 100
 
 #define BUFFER_SIZE 1024
+#define REQUEST_SIZE 1024
+#define REQUEST_ARENA_SIZE 65536 /* 每个请求的 arena 大小，需容纳 MAX_RESULTS 个结果及其响应正文 */
+#define TRACE_BUFFER_SIZE 4096
+#define STATS_BUFFER_SIZE 4096 /* /stats 响应正文大小，需容纳 POOL_MAX_POOLS 个对象池及其他统计 */
+#define RESULT_LINE_SIZE 192 /* 每个 ping 结果一行的最大长度 */
+#define TARGET_LINE_SIZE 192 /* /targets 每个目标一行的最大长度 */
+#define TARGETS_DEFAULT_LIMIT 100
+#define TARGETS_MAX_LIMIT 256 /* 受 REQUEST_ARENA_SIZE 限制 */
 #define HTTP_VERSION "HTTP/1.1"
 #define RESPONSE_OK "HTTP/1.1 200 OK\r\nContent-Type: text/csv\r\nContent-Length: %d\r\n\r\n"
 // #define RESPONSE_TEMPLATE "HTTP/1.1 200 OK\r\nContent-Type: text/html\r\nContent-Length: %d\r\n\r\n%s"
 
+/*
+ * 连接对象，从固定容量的对象池分配，请求期间的临时数据从内嵌的 arena 分配
+ */
+struct http_conn
+{
+    int socket;                                    // 客户端套接字
+    char request[REQUEST_SIZE];                    // 请求内容
+    struct arena arena;                            // 请求 arena
+    unsigned char arena_memory[REQUEST_ARENA_SIZE]; // arena 内存
+};
+
+/*
+ * 启动时预分配连接对象池
+ * 返回值:
+ *   0: 成功
+ *   -1: 失败
+ */
+int http_server_init();
+
+/*
+ * 设置单个 ping 请求的最大 icmp_num，重新加载配置时调用
+ * 参数:
+ *   max_results: 上限，超过编译时的 MAX_RESULTS 时按 MAX_RESULTS 处理
+ */
+void http_server_set_max_results(int max_results);
+
 /*
  * 解析 HTTP 请求，检查请求的有效性
  * 参数:
@@ -25,6 +62,42 @@
  */
 int parse_request(const char *request, char *ip, int *icmp_num);
 
+/*
+ * 解析路由追踪请求 GET /traceroute?ip=x.x.x.x[&max_hops=n]
+ * 参数:
+ *   request: HTTP 请求字符串
+ *   ip: 存储提取的 IP 地址
+ *   max_hops: 存储提取的最大跳数，未指定时为 TRACE_MAX_HOPS
+ * 返回值:
+ *   200: 请求有效
+ *   400: 错误的请求
+ */
+int parse_traceroute_request(const char *request, char *ip, int *max_hops);
+
+/*
+ * 解析持续探测目标的查询请求 GET /targets[?offset=n][&limit=n]
+ * 参数:
+ *   request: HTTP 请求字符串
+ *   offset: 存储起始下标，未指定时为0
+ *   limit: 存储最大个数，未指定时为 TARGETS_DEFAULT_LIMIT
+ * 返回值:
+ *   200: 请求有效
+ *   400: 错误的请求
+ */
+int parse_targets_request(const char *request, int *offset, int *limit);
+
+/*
+ * 将 ping 结果序列化为响应正文，每个结果一行
+ * 参数:
+ *   buffer: 输出缓冲区
+ *   size: 缓冲区大小
+ *   results: ping 结果
+ *   count: 结果个数
+ * 返回值:
+ *   写入的字节数（不含结尾的 '\0'）
+ */
+int format_ping_results(char *buffer, int size, const struct ping_result *results, int count);
+
 /*
  * 处理客户端请求
  * 参数:
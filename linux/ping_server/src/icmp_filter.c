@@ -0,0 +1,168 @@
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <linux/filter.h>
+
+#include "icmp_ping.h"
+#include "icmp_filter.h"
+
+#ifndef ICMP_FILTER
+#define ICMP_FILTER 1 /* <linux/icmp.h>，SOL_RAW 层按类型过滤的选项 */
+#endif
+
+#define FILTER_LEN 24 /* 过滤程序指令数 */
+
+static struct icmp_filter_stats stats;
+
+static int open_sockets = 0;        // 当前打开的套接字数
+static int window_active = 0;       // 上次采样以来是否有套接字打开
+static int snmp_fd = -1;            // 保持打开，采样时 pread，避免每次 fopen
+static uint64_t last_in_msgs = 0;   // 上次采样时主机的 InMsgs
+static uint64_t last_delivered = 0; // 上次采样时的 delivered
+
+/*
+ * 读取主机累计收到的 ICMP 报文数（/proc/net/snmp 中 Icmp: InMsgs），失败返回0
+ */
+static uint64_t read_icmp_in_msgs()
+{
+    if (snmp_fd == -1)
+    {
+        snmp_fd = open(ICMP_FILTER_SNMP, O_RDONLY | O_CLOEXEC);
+        if (snmp_fd == -1)
+        {
+            return 0;
+        }
+    }
+
+    char buffer[4096];
+    int bytes = pread(snmp_fd, buffer, sizeof(buffer) - 1, 0);
+    if (bytes <= 0)
+    {
+        return 0;
+    }
+    buffer[bytes] = '\0';
+
+    // 第一行 "Icmp:" 是字段名，第二行是数值，InMsgs 是第一个字段
+    const char *header = strstr(buffer, "\nIcmp:");
+    const char *values = header != NULL ? strstr(header + 1, "\nIcmp:") : NULL;
+    unsigned long long in_msgs = 0;
+    if (values == NULL || sscanf(values + 6, "%llu", &in_msgs) != 1)
+    {
+        return 0;
+    }
+    return in_msgs;
+}
+
+/*
+ * 采样并结算：两次采样之间有套接字打开时，主机收到的 ICMP 报文中没有交给本进程的部分
+ */
+static void sample_undelivered()
+{
+    uint64_t in_msgs = read_icmp_in_msgs();
+    if (window_active && in_msgs > last_in_msgs)
+    {
+        uint64_t received = in_msgs - last_in_msgs;
+        uint64_t delivered = stats.delivered - last_delivered;
+        if (received > delivered)
+        {
+            stats.undelivered += received - delivered;
+        }
+    }
+    last_in_msgs = in_msgs;
+    last_delivered = stats.delivered;
+    window_active = open_sockets > 0;
+}
+
+void icmp_filter_set_range(uint16_t ident_lo, uint16_t ident_hi)
+{
+    stats.ident_lo = ident_lo;
+    stats.ident_hi = ident_hi;
+    sample_undelivered(); // 记录初始的 InMsgs
+}
+
+/*
+ * 生成只接受标识符在 [ident_lo, ident_hi] 内的过滤程序
+ */
+static void build_filter(struct sock_filter *filter_code, uint16_t ident_lo, uint16_t ident_hi)
+{
+    /*
+        偏移量相对 IP 头部起始，X 寄存器保存 ICMP 报文的偏移
+        Echo 应答：ICMP[4:2] 即 ident
+        差错报文：ICMP[8] 起为原始 IP 头部，其后为原始 ICMP Echo 请求
+    */
+    struct sock_filter code[FILTER_LEN] = {
+        /* 0 */ BPF_STMT(BPF_LDX | BPF_B | BPF_MSH, 0),                        // X = 外层 IP 头部长度
+        /* 1 */ BPF_STMT(BPF_LD | BPF_B | BPF_IND, 0),                         // A = 类型
+        /* 2 */ BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, ICMP_ECHOREPLY, 5, 0),     // -> 8
+        /* 3 */ BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, ICMP_DEST_UNREACH, 6, 0),  // -> 10
+        /* 4 */ BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, ICMP_TIME_EXCEEDED, 5, 0), // -> 10
+        /* 5 */ BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, ICMP_SOURCE_QUENCH, 4, 0), // -> 10
+        /* 6 */ BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, ICMP_PARAMETERPROB, 3, 0), // -> 10
+        /* 7 */ BPF_STMT(BPF_RET | BPF_K, 0),                                  // 其他类型丢弃
+        /* 8 */ BPF_STMT(BPF_LD | BPF_H | BPF_IND, 4),                         // A = ident
+        /* 9 */ BPF_STMT(BPF_JMP | BPF_JA, 10),                                // -> 20
+        /* 10 */ BPF_STMT(BPF_LD | BPF_B | BPF_IND, 8 + 9),                    // A = 原始 IP 头部的协议
+        /* 11 */ BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, IPPROTO_ICMP, 0, 10),     // 不是 ICMP -> 22
+        /* 12 */ BPF_STMT(BPF_LD | BPF_B | BPF_IND, 8),                        // A = 原始 IP 版本和头部长度
+        /* 13 */ BPF_STMT(BPF_ALU | BPF_AND | BPF_K, 0xf),
+        /* 14 */ BPF_STMT(BPF_ALU | BPF_LSH | BPF_K, 2),                       // A = 原始 IP 头部长度
+        /* 15 */ BPF_STMT(BPF_ALU | BPF_ADD | BPF_X, 0),
+        /* 16 */ BPF_STMT(BPF_MISC | BPF_TAX, 0),                              // X + 8 = 原始 ICMP 报文偏移
+        /* 17 */ BPF_STMT(BPF_LD | BPF_B | BPF_IND, 8),                        // A = 原始类型
+        /* 18 */ BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, ICMP_ECHO, 0, 3),         // 不是 Echo 请求 -> 22
+        /* 19 */ BPF_STMT(BPF_LD | BPF_H | BPF_IND, 8 + 4),                    // A = 原始 ident
+        /* 20 */ BPF_JUMP(BPF_JMP | BPF_JGE | BPF_K, ident_lo, 0, 1),          // < lo -> 22
+        /* 21 */ BPF_JUMP(BPF_JMP | BPF_JGT | BPF_K, ident_hi, 0, 1),          // <= hi -> 23
+        /* 22 */ BPF_STMT(BPF_RET | BPF_K, 0),                                 // 丢弃
+        /* 23 */ BPF_STMT(BPF_RET | BPF_K, 0x40000),                           // 接受整个报文
+    };
+    memcpy(filter_code, code, sizeof(code));
+}
+
+int icmp_filter_attach(int sock, uint16_t ident_lo, uint16_t ident_hi)
+{
+    // 按类型过滤：只保留 Echo 应答和四种差错报文，其余类型（包括发往本机的 Echo 请求）在内核丢弃
+    uint32_t type_mask = ~((1U << ICMP_ECHOREPLY) | (1U << ICMP_DEST_UNREACH) | (1U << ICMP_SOURCE_QUENCH) |
+                           (1U << ICMP_TIME_EXCEEDED) | (1U << ICMP_PARAMETERPROB));
+    if (setsockopt(sock, SOL_RAW, ICMP_FILTER, &type_mask, sizeof(type_mask)) == -1)
+    {
+        perror("set icmp filter");
+    }
+
+    open_sockets++;
+    window_active = 1;
+
+    // 每个套接字只接受自己的标识符，应答不会复制到其他套接字的接收队列
+    struct sock_filter filter_code[FILTER_LEN];
+    build_filter(filter_code, ident_lo, ident_hi);
+    struct sock_fprog prog = {FILTER_LEN, filter_code};
+    if (setsockopt(sock, SOL_SOCKET, SO_ATTACH_FILTER, &prog, sizeof(prog)) == -1)
+    {
+        perror("attach socket filter");
+        return -1;
+    }
+    stats.attached++;
+    return 0;
+}
+
+void icmp_filter_detach(int sock)
+{
+    (void)sock;
+    if (open_sockets > 0)
+    {
+        open_sockets--;
+    }
+}
+
+void icmp_filter_count_delivered()
+{
+    stats.delivered++;
+}
+
+void icmp_filter_get_stats(struct icmp_filter_stats *out)
+{
+    sample_undelivered();
+    *out = stats;
+}
@@ -0,0 +1,56 @@
+#ifndef ICMP_FILTER_H
+#define ICMP_FILTER_H
+
+#include <stdint.h>
+
+#define ICMP_FILTER_SNMP "/proc/net/snmp" /**< 主机 ICMP 收包计数，用于估算内核过滤掉的包数 */
+
+/**
+ * @brief 内核过滤统计
+ */
+struct icmp_filter_stats
+{
+    uint16_t ident_lo;  /**< 进程标识符范围下限 */
+    uint16_t ident_hi;  /**< 进程标识符范围上限 */
+    uint64_t attached;  /**< 成功挂载过滤程序的套接字数 */
+    uint64_t delivered;   /**< 通过过滤、交给用户态的包数 */
+    uint64_t undelivered; /**< 估算值：有套接字打开期间主机收到、但没有交给本进程的 ICMP 报文数。
+                               InMsgs 是全机计数，包括发给其他进程的报文，不等于本过滤程序丢弃的包数 */
+};
+
+/**
+ * @brief 记录进程的标识符范围（用于统计输出），并开始采样主机 ICMP 收包计数
+ * @param ident_lo 范围下限
+ * @param ident_hi 范围上限（含）
+ */
+void icmp_filter_set_range(uint16_t ident_lo, uint16_t ident_hi);
+
+/**
+ * @brief 在原始 ICMP 套接字上设置 ICMP_FILTER 类型过滤，并挂载 SO_ATTACH_FILTER 程序：
+ *        只接受标识符在范围内的 Echo 应答，以及引用了范围内 Echo 请求的差错报文。
+ *        只使用一个标识符的套接字传入 ident_lo == ident_hi，避免应答复制到其他套接字
+ * @param sock 套接字描述符
+ * @param ident_lo 范围下限
+ * @param ident_hi 范围上限（含）
+ * @return 成功返回0，失败返回-1（套接字仍可用，由用户态继续过滤）
+ */
+int icmp_filter_attach(int sock, uint16_t ident_lo, uint16_t ident_hi);
+
+/**
+ * @brief 套接字关闭前调用
+ * @param sock 套接字描述符
+ */
+void icmp_filter_detach(int sock);
+
+/**
+ * @brief 用户态每收到一个包调用一次
+ */
+void icmp_filter_count_delivered();
+
+/**
+ * @brief 采样 /proc/net/snmp 结算 undelivered，并获取内核过滤统计
+ * @param stats 统计结果
+ */
+void icmp_filter_get_stats(struct icmp_filter_stats *stats);
+
+#endif /* ICMP_FILTER_H */
@@ -1,5 +1,110 @@
 #include "icmp_ping.h"
 
+static struct object_pool recv_buffer_pool; // 接收缓冲区
+static struct object_pool probe_table_pool; // 探测分发表
+
+static uint16_t ident_base; // 标识符范围起始
+static int ident_next = 0;  // 下一个分配的标识符相对 ident_base 的偏移
+
+static int background_fd = -1;             // 后台套接字
+static double (*background_hook)() = NULL; // 后台任务
+
+static char probe_magic[MAGIC_LEN] = MAGIC;              // Echo 请求的魔术字符串
+static int probe_recv_timeout_usec = RECV_TIMEOUT_USEC; // ping 的接收超时
+static double probe_interval = 1;                       // ping 两个包之间的间隔（秒）
+
+int icmp_ping_init()
+{
+    if (pool_init(&recv_buffer_pool, "recv_buffer", IP_BUFFER_SIZE, RECV_BUFFER_POOL_SIZE) != 0 ||
+        pool_init(&probe_table_pool, "probe_table", sizeof(struct probe_table), PROBE_TABLE_POOL_SIZE) != 0)
+    {
+        return -1;
+    }
+
+    // 标识符范围从进程号开始，不跨越 0xffff
+    int base = getpid() & 0xffff;
+    if (base > 0x10000 - IDENT_RANGE_SIZE)
+    {
+        base = 0x10000 - IDENT_RANGE_SIZE;
+    }
+    ident_base = base;
+    icmp_filter_set_range(ident_base, ident_base + IDENT_RANGE_SIZE - 1);
+    return 0;
+}
+
+void icmp_ping_set_options(const char *magic, int recv_timeout_usec, int interval_ms)
+{
+    bzero(probe_magic, sizeof(probe_magic));
+    snprintf(probe_magic, sizeof(probe_magic), "%s", magic);
+    probe_recv_timeout_usec = recv_timeout_usec;
+    probe_interval = interval_ms / 1000.0;
+}
+
+uint16_t icmp_ident_alloc()
+{
+    uint16_t ident = ident_base + ident_next;
+    ident_next = (ident_next + 1) % (IDENT_RANGE_SIZE - 1);
+    return ident;
+}
+
+uint16_t icmp_ident_reserved()
+{
+    return ident_base + IDENT_RANGE_SIZE - 1;
+}
+
+int icmp_socket_open(uint16_t ident)
+{
+    // 创建一个原始套接字，协议类型为 IPPROTO_ICMP
+    int sock = socket(AF_INET, SOCK_RAW, IPPROTO_ICMP);
+    if (sock == -1)
+    {
+        perror("create raw socket");
+        return -1;
+    }
+
+    // 在内核中过滤掉不属于我们的 ICMP 报文，失败时仍由用户态过滤
+    icmp_filter_attach(sock, ident, ident);
+
+    // 使用内核接收时间戳，等待期间执行后台任务也不会拉长往返时间
+    int on = 1;
+    if (setsockopt(sock, SOL_SOCKET, SO_TIMESTAMP, &on, sizeof(on)) == -1)
+    {
+        perror("set timestamp option");
+    }
+    return sock;
+}
+
+void icmp_socket_close(int sock)
+{
+    icmp_filter_detach(sock);
+    close(sock);
+}
+
+unsigned char *recv_buffer_alloc()
+{
+    return pool_alloc(&recv_buffer_pool);
+}
+
+void recv_buffer_release(unsigned char *buffer)
+{
+    pool_free(&recv_buffer_pool, buffer);
+}
+
+struct probe_table *probe_table_alloc()
+{
+    struct probe_table *table = pool_alloc(&probe_table_pool);
+    if (table != NULL)
+    {
+        probe_table_init(table);
+    }
+    return table;
+}
+
+void probe_table_release(struct probe_table *table)
+{
+    pool_free(&probe_table_pool, table);
+}
+
 double get_timestamp()
 {
     struct timeval tv;
@@ -36,6 +141,13 @@ uint16_t calculate_checksum(unsigned char *buffer, int bytes)
 
 char *get_cur_ip()
 {
+    // getifaddrs 会分配内存，结果缓存后每个 ping 结果不再重复查询
+    static char cur_ip[IPV4_LEN];
+    if (cur_ip[0] != '\0')
+    {
+        return cur_ip;
+    }
+
     struct ifaddrs *ifaddr, *ifa;
     if (getifaddrs(&ifaddr) == -1)
     {
@@ -61,7 +173,8 @@ char *get_cur_ip()
             // 排除回环接口
             if (strcmp(ifa->ifa_name, "lo") != 0)
             {
-                ip = inet_ntoa(addr->sin_addr);
+                strcpy(cur_ip, inet_ntoa(addr->sin_addr));
+                ip = cur_ip;
                 break;
             }
         }
@@ -79,7 +192,7 @@ int send_echo_request(int sock, struct sockaddr_in *addr, int ident, int seq)
     icmp.code = 0;
     icmp.ident = htons(ident); // htons函数将进程识别码转换为网络字节序
     icmp.seq = htons(seq);
-    strncpy(icmp.magic, MAGIC, MAGIC_LEN); // 用于在ICMP Echo请求消息中填充一些特定信息
+    strncpy(icmp.magic, probe_magic, MAGIC_LEN); // 用于在ICMP Echo请求消息中填充一些特定信息
     icmp.sending_ts = get_timestamp();
     icmp.checksum = htons(calculate_checksum((unsigned char *)&icmp, sizeof(icmp)));
 
@@ -100,64 +213,322 @@ int send_echo_request(int sock, struct sockaddr_in *addr, int ident, int seq)
     return 0;
 }
 
-struct ping_result recv_echo_reply(int sock, int ident)
+void icmp_set_background(int fd, double (*hook)())
 {
-    struct ping_result default_result = {"", "", "", 0, 0.00};
-    // 定义缓冲区
-    unsigned char buffer[IP_BUFFER_SIZE];
-    struct sockaddr_in peer_addr;
-    int addr_len = sizeof(peer_addr);
-    /*
-        recvfrom()本函数用于从（已连接）套接口上接收数据，并捕获数据发送源的地址
-        s：标识一个已连接套接口的描述字。
-        buf：接收数据缓冲区。
-        len：缓冲区长度。
-        flags：调用操作方式。
-        from：（可选）指针，指向装有源地址的缓冲区。
-        fromlen：（可选）指针，指向from缓冲区长度值。
-    */
-    int bytes = recvfrom(sock, buffer, sizeof(buffer), 0, (struct sockaddr *)&peer_addr, &addr_len);
-    if (bytes == -1)
+    background_fd = fd;
+    background_hook = hook;
+}
+
+int icmp_wait_readable(int sock, double timeout)
+{
+    double deadline = get_timestamp() + timeout;
+    for (;;)
     {
-        if (errno == EAGAIN || errno == EWOULDBLOCK)
+        // 先执行到期的后台事件，再等到截止时间和后台下一个事件中较早的一个
+        double wait_until = deadline;
+        if (background_hook != NULL)
         {
-            return default_result;
+            double next_event = background_hook();
+            if (next_event != 0 && next_event < wait_until)
+            {
+                wait_until = next_event;
+            }
+        }
+        double wait = wait_until - get_timestamp();
+        int wait_ms = wait > 0 ? (int)(wait * 1000) + 1 : 0;
+
+        struct pollfd fds[2] = {{sock, POLLIN, 0}, {background_fd, POLLIN, 0}};
+        int ret = poll(fds, background_fd >= 0 ? 2 : 1, wait_ms);
+        if (ret == -1 && errno != EINTR)
+        {
+            perror("poll");
+            return -1;
+        }
+        if (ret > 0 && (fds[0].revents & POLLIN))
+        {
+            return 1;
+        }
+        if (get_timestamp() >= deadline)
+        {
+            return 0;
         }
-        perror("Failed to receive ICMP echo reply");
-        return default_result;
     }
+}
 
-    // IP头部长度
-    int ip_header_len = (buffer[0] & 0xf) << 2;
-    // 从 IP 报文中取出 ICMP 报文
-    struct icmp_echo *icmp = (struct icmp_echo *)(buffer + ip_header_len); // ICMP 报文紧随 IP 头部之后
-    if (icmp->type != ICMP_ECHOREPLY || icmp->code != 0)
+/*
+ * 处理收到的一个报文，返回完成的探测包结果，seq为0表示没有
+ */
+static struct ping_result handle_echo_reply(const unsigned char *buffer, int bytes, double recv_ts, int ident, struct probe_table *table)
+{
+    struct ping_result default_result = {"", "", "", 0, 0.00, PING_STATUS_OK, ""};
+
+    // 解析 Echo 应答或差错报文中引用的原始请求
+    struct icmp_reply_info info;
+    if (parse_icmp_reply(buffer, bytes, &info) != 0)
     {
         return default_result;
     }
-
-    // ntohs()是一个函数名，作用是将一个16位数由网络字节顺序转换为主机字节顺序
-    if (ntohs(icmp->ident) != ident)
+    if (info.type == ICMP_ECHOREPLY && info.code != 0)
+    {
+        return default_result;
+    }
+    if (info.ident != ident)
     {
         return default_result;
     }
+    info.recv_ts = recv_ts;
 
-    double time_ms = (get_timestamp() - icmp->sending_ts) * 1000;
-    printf("%s seq=%-5d %8.2fms\n",
-           inet_ntoa(peer_addr.sin_addr),
-           ntohs(icmp->seq),
-           time_ms);
+    // 对应回等待中的探测包，重复或过期的应答直接丢弃
+    struct probe_entry *entry = probe_table_match(table, &info);
+    if (entry == NULL)
+    {
+        return default_result;
+    }
 
     struct ping_result ping_result;
     bzero(&ping_result, sizeof(ping_result));
     strcpy(ping_result.ipv4_source, get_cur_ip());
-    strcpy(ping_result.ipv4_target, inet_ntoa(peer_addr.sin_addr));
-    ping_result.seq = ntohs(icmp->seq);
-    ping_result.time = time_ms;
+    ping_result.seq = entry->seq;
+    ping_result.time = entry->time;
+    ping_result.status = ping_status_from_icmp(entry->type);
+    if (ping_result.status == PING_STATUS_OK)
+    {
+        strcpy(ping_result.ipv4_target, inet_ntoa(entry->from));
+        printf("%s seq=%-5d %8.2fms\n", ping_result.ipv4_target, ping_result.seq, ping_result.time);
+    }
+    else
+    {
+        strcpy(ping_result.ipv4_reporter, inet_ntoa(entry->from));
+        printf("%s seq=%-5d %s code=%d\n", ping_result.ipv4_reporter, ping_result.seq, ping_status_str(ping_result.status), entry->code);
+    }
 
     return ping_result;
 }
 
+int icmp_recv(int sock, unsigned char *buffer, int size, double *recv_ts)
+{
+    struct iovec iov = {buffer, size};
+    char control[CMSG_SPACE(sizeof(struct timeval))];
+    struct msghdr msg;
+    bzero(&msg, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    int bytes = recvmsg(sock, &msg, MSG_DONTWAIT);
+    if (bytes <= 0)
+    {
+        if (bytes == -1 && errno != EAGAIN && errno != EWOULDBLOCK)
+        {
+            perror("Failed to receive ICMP reply");
+        }
+        return -1;
+    }
+    icmp_filter_count_delivered();
+
+    *recv_ts = 0;
+    for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg != NULL; cmsg = CMSG_NXTHDR(&msg, cmsg))
+    {
+        if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_TIMESTAMP)
+        {
+            struct timeval tv;
+            memcpy(&tv, CMSG_DATA(cmsg), sizeof(tv));
+            *recv_ts = tv.tv_sec + ((double)tv.tv_usec) / 1000000;
+        }
+    }
+    if (*recv_ts == 0)
+    {
+        *recv_ts = get_timestamp();
+    }
+    return bytes;
+}
+
+int recv_echo_replies(int sock, int ident, struct probe_table *table, double timeout, struct ping_result *results, int max)
+{
+    // 从对象池取出接收缓冲区
+    unsigned char *buffer = recv_buffer_alloc();
+    if (buffer == NULL)
+    {
+        fprintf(stderr, "recv buffer pool exhausted\n");
+        return 0;
+    }
+
+    // 等待期间继续执行后台的持续探测，醒来后读空接收队列，避免应答在队列中堆积
+    int count = 0;
+    if (icmp_wait_readable(sock, timeout) == 1)
+    {
+        int bytes;
+        double recv_ts;
+        while (count < max && (bytes = icmp_recv(sock, buffer, IP_BUFFER_SIZE, &recv_ts)) != -1)
+        {
+            struct ping_result ping_result = handle_echo_reply(buffer, bytes, recv_ts, ident, table);
+            if (ping_result.seq != 0)
+            {
+                results[count++] = ping_result;
+            }
+        }
+    }
+    recv_buffer_release(buffer);
+    return count;
+}
+
+int parse_icmp_reply(const unsigned char *buffer, int bytes, struct icmp_reply_info *info)
+{
+    // 外层 IP 头部长度
+    int ip_header_len = (buffer[0] & 0xf) << 2;
+    if (bytes < ip_header_len + 8)
+    {
+        return -1;
+    }
+
+    const unsigned char *icmp = buffer + ip_header_len;
+    bzero(info, sizeof(*info));
+    info->type = icmp[0];
+    info->code = icmp[1];
+    memcpy(&info->from, buffer + 12, sizeof(info->from)); // IP 头部中的源地址
+
+    if (info->type == ICMP_ECHOREPLY)
+    {
+        const struct icmp_echo *echo = (const struct icmp_echo *)icmp;
+        info->target = info->from;
+        info->ident = ntohs(echo->ident);
+        info->seq = ntohs(echo->seq);
+        return 0;
+    }
+
+    if (info->type != ICMP_DEST_UNREACH && info->type != ICMP_TIME_EXCEEDED &&
+        info->type != ICMP_SOURCE_QUENCH && info->type != ICMP_PARAMETERPROB)
+    {
+        return -1;
+    }
+
+    // 差错报文：8字节 ICMP 头部之后是原始 IP 头部及其后至少8字节数据
+    const unsigned char *inner_ip = icmp + 8;
+    if (bytes < ip_header_len + 8 + 20)
+    {
+        return -1;
+    }
+    int inner_ip_header_len = (inner_ip[0] & 0xf) << 2;
+    if (inner_ip[9] != IPPROTO_ICMP || bytes < ip_header_len + 8 + inner_ip_header_len + 8)
+    {
+        return -1;
+    }
+
+    const struct icmp_echo *echo = (const struct icmp_echo *)(inner_ip + inner_ip_header_len);
+    if (echo->type != ICMP_ECHO)
+    {
+        return -1;
+    }
+    memcpy(&info->target, inner_ip + 16, sizeof(info->target)); // 原始 IP 头部中的目的地址
+    info->ident = ntohs(echo->ident);
+    info->seq = ntohs(echo->seq);
+    return 0;
+}
+
+void probe_table_init(struct probe_table *table)
+{
+    bzero(table, sizeof(*table));
+}
+
+struct probe_entry *probe_table_add(struct probe_table *table, uint16_t ident, uint16_t seq, double sending_ts)
+{
+    struct probe_entry *entry = &table->entries[seq & (PROBE_TABLE_SIZE - 1)];
+    if (entry->state == PROBE_PENDING)
+    {
+        return NULL;
+    }
+
+    bzero(entry, sizeof(*entry));
+    entry->state = PROBE_PENDING;
+    entry->ident = ident;
+    entry->seq = seq;
+    entry->sending_ts = sending_ts;
+    table->pending++;
+    return entry;
+}
+
+struct probe_entry *probe_table_match(struct probe_table *table, const struct icmp_reply_info *info)
+{
+    struct probe_entry *entry = &table->entries[info->seq & (PROBE_TABLE_SIZE - 1)];
+    if (entry->state != PROBE_PENDING || entry->ident != info->ident || entry->seq != info->seq)
+    {
+        return NULL;
+    }
+
+    entry->state = PROBE_DONE;
+    entry->type = info->type;
+    entry->code = info->code;
+    entry->from = info->from;
+    double recv_ts = info->recv_ts != 0 ? info->recv_ts : get_timestamp();
+    // sending_ts 在 sendto 返回后记录，本机目标的应答可能更早到达
+    entry->time = recv_ts > entry->sending_ts ? (recv_ts - entry->sending_ts) * 1000 : 0;
+    table->pending--;
+    return entry;
+}
+
+struct probe_entry *probe_table_expire(struct probe_table *table, double sent_before)
+{
+    if (table->pending == 0)
+    {
+        return NULL;
+    }
+
+    for (int i = 0; i < PROBE_TABLE_SIZE; i++)
+    {
+        struct probe_entry *entry = &table->entries[i];
+        if (entry->state == PROBE_PENDING && entry->sending_ts < sent_before)
+        {
+            entry->state = PROBE_TIMEOUT;
+            table->pending--;
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+int ping_status_from_icmp(uint8_t type)
+{
+    switch (type)
+    {
+    case ICMP_ECHOREPLY:
+        return PING_STATUS_OK;
+    case ICMP_DEST_UNREACH:
+        return PING_STATUS_DEST_UNREACH;
+    case ICMP_TIME_EXCEEDED:
+        return PING_STATUS_TIME_EXCEEDED;
+    case ICMP_SOURCE_QUENCH:
+        return PING_STATUS_SOURCE_QUENCH;
+    case ICMP_PARAMETERPROB:
+        return PING_STATUS_PARAMETER_PROBLEM;
+    default:
+        return PING_STATUS_TIMEOUT;
+    }
+}
+
+const char *ping_status_str(int status)
+{
+    switch (status)
+    {
+    case PING_STATUS_OK:
+        return "ok";
+    case PING_STATUS_TIMEOUT:
+        return "timeout";
+    case PING_STATUS_DEST_UNREACH:
+        return "dest_unreach";
+    case PING_STATUS_TIME_EXCEEDED:
+        return "time_exceeded";
+    case PING_STATUS_SOURCE_QUENCH:
+        return "source_quench";
+    case PING_STATUS_PARAMETER_PROBLEM:
+        return "parameter_problem";
+    case PING_STATUS_DROPPED:
+        return "dropped";
+    default:
+        return "unknown";
+    }
+}
+
 int ping(const char *ip, int icmp_num, struct ping_result *result)
 {
 
@@ -172,56 +543,90 @@ int ping(const char *ip, int icmp_num, struct ping_result *result)
         return -1;
     }
 
-    // 创建一个原始套接字，协议类型为 IPPROTO_ICMP
-    int sock = socket(AF_INET, SOCK_RAW, IPPROTO_ICMP);
+    int ident = icmp_ident_alloc(); // 从进程的标识符范围中分配
+    int sock = icmp_socket_open(ident);
     if (sock == -1)
     {
-        perror("create raw socket");
         return -1;
     }
 
-    // 设置接收超时时间
-    struct timeval tv;
-    tv.tv_sec = 0;
-    tv.tv_usec = RECV_TIMEOUT_USEC;
-    int ret = setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
-    if (ret == -1)
+    struct probe_table *table = probe_table_alloc();
+    if (table == NULL)
     {
-        perror("set socket option");
-        close(sock);
+        fprintf(stderr, "probe table pool exhausted\n");
+        icmp_socket_close(sock);
         return -1;
     }
 
     double next_ts = get_timestamp();
-    int ident = getpid(); // 取得进程识别码
+    double send_ts = 0; // 已预约的发送时间，0 表示没有
     int seq = 1;
     int exit_flag = 0;
 
     for (;;)
     {
         double current_ts = get_timestamp();
-        if (current_ts >= next_ts)
+        if (seq <= icmp_num && current_ts >= next_ts && send_ts == 0)
         {
-            ret = send_echo_request(sock, &addr, ident, seq);
+            // 预约发送时间，不阻塞：未到时间时先继续收包，排队过久则丢弃
+            send_ts = pacer_reserve(addr.sin_addr, current_ts);
+            if (send_ts < 0)
+            {
+                struct ping_result dropped_result = {"", "", "", seq, 0.00, PING_STATUS_DROPPED, ""};
+                strcpy(dropped_result.ipv4_source, get_cur_ip());
+                result[exit_flag] = dropped_result;
+                exit_flag++;
+                next_ts = current_ts + probe_interval;
+                seq++;
+                send_ts = 0;
+            }
+        }
+        if (send_ts > 0 && current_ts >= send_ts)
+        {
+            int ret = send_echo_request(sock, &addr, ident, seq);
             if (ret == -1)
             {
                 perror("Send failed");
-                close(sock);
+                probe_table_release(table);
+                icmp_socket_close(sock);
                 return -1;
             }
-            next_ts = current_ts + 1;
+            probe_table_add(table, ident, seq, get_timestamp());
+            next_ts = current_ts + probe_interval;
             seq++;
+            send_ts = 0;
+        }
+
+        double timeout = probe_recv_timeout_usec / 1000000.0;
+        if (send_ts > 0 && send_ts - current_ts < timeout)
+        {
+            timeout = send_ts - current_ts;
         }
+        exit_flag += recv_echo_replies(sock, ident, table, timeout, result + exit_flag, icmp_num - exit_flag);
 
-        struct ping_result ping_result = recv_echo_reply(sock, ident);
-        if (ping_result.seq != 0)
+        // 超时未应答的探测包也算作一个结果，避免一直等待
+        struct probe_entry *expired;
+        while ((expired = probe_table_expire(table, get_timestamp() - PING_TIMEOUT_SEC)) != NULL)
         {
-            result[exit_flag] = ping_result;
+            struct ping_result timeout_result = {"", "", "", expired->seq, 0.00, PING_STATUS_TIMEOUT, ""};
+            strcpy(timeout_result.ipv4_source, get_cur_ip());
+            result[exit_flag] = timeout_result;
             exit_flag++;
         }
         if (exit_flag >= icmp_num)
             break;
     }
 
+    // 差错和超时的结果没有目标应答，目标地址使用请求的地址，差错报文的来源记录在 ipv4_reporter 中
+    for (int i = 0; i < exit_flag; i++)
+    {
+        if (result[i].ipv4_target[0] == '\0')
+        {
+            strcpy(result[i].ipv4_target, ip);
+        }
+    }
+
+    probe_table_release(table);
+    icmp_socket_close(sock);
     return 0;
 }
@@ -11,6 +11,11 @@
 #include <errno.h>
 #include <sys/socket.h>
 #include <ifaddrs.h>
+#include <poll.h>
+
+#include "pacer.h"
+#include "pool.h"
+#include "icmp_filter.h"
 
 #define ICMP_ECHO 8      /* Echo Request			*/
 #define ICMP_ECHOREPLY 0 /* Echo Reply			*/
@@ -32,10 +37,29 @@
 #define MAGIC_LEN 11             /**< 魔术字符串长度 */
 #define IP_BUFFER_SIZE 65536     /**< 接收缓冲区大小 */
 #define RECV_TIMEOUT_USEC 100000 /**< 接收超时时间（微秒） */
+#define PING_TIMEOUT_SEC 2       /**< 探测包等待应答的最长时间（秒） */
 
 #define IPV4_LEN 16
 #define IPV6_LEN 40
 
+#define PROBE_TABLE_SIZE 256 /**< 探测分发表容量（必须为2的幂） */
+#define PROBE_TABLE_POOL_SIZE 4 /**< 探测分发表对象池容量，即同时进行的 ping/traceroute 个数 */
+#define RECV_BUFFER_POOL_SIZE 4 /**< 接收缓冲区对象池容量 */
+#define IDENT_RANGE_SIZE (PROBE_TABLE_POOL_SIZE + 1) /**< 进程使用的标识符个数，每个进行中的 ping/traceroute 一个，最后一个留给持续探测 */
+
+#define PROBE_FREE 0    /**< 表项空闲 */
+#define PROBE_PENDING 1 /**< 已发送，等待应答 */
+#define PROBE_DONE 2    /**< 已收到应答 */
+#define PROBE_TIMEOUT 3 /**< 等待应答超时 */
+
+#define PING_STATUS_OK 0                /**< 收到 Echo 应答 */
+#define PING_STATUS_TIMEOUT 1           /**< 超时未收到应答 */
+#define PING_STATUS_DEST_UNREACH 2      /**< 目标不可达 */
+#define PING_STATUS_TIME_EXCEEDED 3     /**< TTL 超时 */
+#define PING_STATUS_SOURCE_QUENCH 4     /**< 源抑制 */
+#define PING_STATUS_PARAMETER_PROBLEM 5 /**< 参数问题 */
+#define PING_STATUS_DROPPED 6           /**< 被发包调度丢弃，未发送 */
+
 /**
  * @brief ICMP Echo 请求数据结构  __attribute__((__packed__)) 属性告诉编译器不要对结构体中的字段进行任何填充,确保了结构体的大小正好是这些字段大小的总和
  */
@@ -60,8 +84,128 @@ struct ping_result
     char ipv6_target[IPV6_LEN]; // 目标主机ip IPv6
     uint16_t seq;               // 发送的包的序列号
     double time;                // ms
+    int status;                 // PING_STATUS_*
+    char ipv4_reporter[IPV4_LEN]; // 返回差错报文的路由器ip
 };
 
+/**
+ * @brief 解析后的 ICMP 应答，对于差错报文，ident/seq 取自其引用的原始 Echo 请求
+ */
+struct icmp_reply_info
+{
+    uint8_t type;         /**< 外层 ICMP 类型 */
+    uint8_t code;         /**< 外层 ICMP 代码 */
+    uint16_t ident;       /**< 原始请求的标识符（主机字节序） */
+    uint16_t seq;         /**< 原始请求的序列号（主机字节序） */
+    struct in_addr from;  /**< 应答的发送方（目标主机或中间路由器） */
+    struct in_addr target; /**< 原始请求的目标地址 */
+    double recv_ts;        /**< 内核接收时间戳，0 表示没有（使用匹配时的当前时间） */
+};
+
+/**
+ * @brief 探测分发表项，记录一个已发出的探测包
+ */
+struct probe_entry
+{
+    uint8_t state;       /**< PROBE_FREE / PROBE_PENDING / PROBE_DONE */
+    uint8_t type;        /**< 应答的 ICMP 类型 */
+    uint8_t code;        /**< 应答的 ICMP 代码 */
+    uint16_t ident;      /**< 标识符 */
+    uint16_t seq;        /**< 序列号 */
+    double sending_ts;   /**< 发送时间戳 */
+    double time;         /**< 往返时间 ms */
+    struct in_addr from; /**< 应答的发送方 */
+};
+
+/**
+ * @brief 探测分发表，按 seq 索引，用于把应答（包括差错报文中的引用）对应回原始探测包
+ *        差错报文只保证引用原始报文的前8个字节，无法取得 sending_ts，因此发送时间记录在表中
+ */
+struct probe_table
+{
+    struct probe_entry entries[PROBE_TABLE_SIZE];
+    int pending; /**< 等待应答的探测包数量 */
+};
+
+/**
+ * @brief 启动时预分配接收缓冲区和探测分发表对象池
+ * @return 成功返回0，失败返回-1
+ */
+int icmp_ping_init();
+
+/**
+ * @brief 设置运行时参数（来自配置文件）
+ * @param magic Echo 请求的魔术字符串，长度小于 MAGIC_LEN
+ * @param recv_timeout_usec ping 的接收超时（微秒）
+ * @param interval_ms ping 两个包之间的间隔（毫秒）
+ */
+void icmp_ping_set_options(const char *magic, int recv_timeout_usec, int interval_ms);
+
+/**
+ * @brief 从进程的标识符范围中轮流分配一个标识符
+ * @return 标识符
+ */
+uint16_t icmp_ident_alloc();
+
+/**
+ * @brief 持续探测专用的标识符，不参与轮流分配
+ * @return 标识符
+ */
+uint16_t icmp_ident_reserved();
+
+/**
+ * @brief 创建原始 ICMP 套接字，并挂载只接受该标识符的内核过滤
+ * @param ident 套接字使用的标识符
+ * @return 套接字描述符，失败返回-1
+ */
+int icmp_socket_open(uint16_t ident);
+
+/**
+ * @brief 关闭由 icmp_socket_open 创建的套接字
+ * @param sock 套接字描述符
+ */
+void icmp_socket_close(int sock);
+
+/**
+ * @brief 设置后台任务：ping/traceroute 等待应答时同时等待后台套接字，
+ *        可读或到了后台的下一个事件时调用 hook，阻塞的请求不会暂停持续探测
+ * @param fd 后台套接字，-1 表示没有
+ * @param hook 后台任务，返回下一个事件的时间戳，0 表示没有
+ */
+void icmp_set_background(int fd, double (*hook)());
+
+/**
+ * @brief 等待套接字可读，期间执行后台任务
+ * @param sock 套接字描述符
+ * @param timeout 最长等待时间（秒）
+ * @return 可读返回1，超时返回0，出错返回-1
+ */
+int icmp_wait_readable(int sock, double timeout);
+
+/**
+ * @brief 从对象池取出一个 IP_BUFFER_SIZE 大小的接收缓冲区
+ * @return 缓冲区，池耗尽时返回NULL
+ */
+unsigned char *recv_buffer_alloc();
+
+/**
+ * @brief 归还接收缓冲区
+ * @param buffer 缓冲区，NULL 时忽略
+ */
+void recv_buffer_release(unsigned char *buffer);
+
+/**
+ * @brief 从对象池取出一个已初始化的探测分发表
+ * @return 分发表，池耗尽时返回NULL
+ */
+struct probe_table *probe_table_alloc();
+
+/**
+ * @brief 归还探测分发表
+ * @param table 分发表，NULL 时忽略
+ */
+void probe_table_release(struct probe_table *table);
+
 /**
  * @brief 获取当前时间戳（秒为单位，包含微秒部分）
  * @return 当前时间戳
@@ -77,13 +221,13 @@ double get_timestamp();
 uint16_t calculate_checksum(unsigned char *buffer, int bytes);
 
 /**
- * @brief 获取当前IP地址
+ * @brief 获取当前IP地址，首次查询后缓存
  * @return 当前IP地址
  */
 char *get_cur_ip();
 
 /**
- * @brief 发送 ICMP Echo 请求
+ * @brief 立即发送 ICMP Echo 请求，调用者须先用 pacer_reserve 预约发送时间并等到该时间
  * @param sock 套接字描述符
  * @param addr 目标地址信息
  * @param ident 标识符
@@ -93,12 +237,82 @@ char *get_cur_ip();
 int send_echo_request(int sock, struct sockaddr_in *addr, int ident, int seq);
 
 /**
- * @brief 接收 ICMP Echo 应答
+ * @brief 非阻塞读取一个报文，并取出内核接收时间戳（套接字由 icmp_socket_open 开启 SO_TIMESTAMP）
+ * @param sock 套接字描述符
+ * @param buffer 接收缓冲区
+ * @param size 缓冲区大小
+ * @param recv_ts 接收时间戳，没有内核时间戳时为当前时间
+ * @return 读取的字节数，没有可读数据或出错返回-1
+ */
+int icmp_recv(int sock, unsigned char *buffer, int size, double *recv_ts);
+
+/**
+ * @brief 等待并接收 ICMP Echo 应答，每次醒来读空接收队列；差错报文会立即结束对应的探测包并返回差错状态
  * @param sock 套接字描述符
  * @param ident 标识符
- * @return 接收ping结果
+ * @param table 探测分发表
+ * @param timeout 最长等待时间（秒）
+ * @param results 完成的探测包结果
+ * @param max results 的容量
+ * @return 完成的探测包个数
+ */
+int recv_echo_replies(int sock, int ident, struct probe_table *table, double timeout, struct ping_result *results, int max);
+
+/**
+ * @brief 解析收到的 IP 报文，提取 Echo 应答，或差错报文（Destination Unreachable、Time Exceeded、
+ *        Source Quench、Parameter Problem）中引用的原始 Echo 请求
+ * @param buffer 含 IP 头部的报文
+ * @param bytes 报文长度
+ * @param info 解析结果
+ * @return 成功返回0，不是我们关心的报文返回-1
+ */
+int parse_icmp_reply(const unsigned char *buffer, int bytes, struct icmp_reply_info *info);
+
+/**
+ * @brief 初始化探测分发表
+ * @param table 分发表
+ */
+void probe_table_init(struct probe_table *table);
+
+/**
+ * @brief 登记一个已发送的探测包
+ * @param table 分发表
+ * @param ident 标识符
+ * @param seq 序列号
+ * @param sending_ts 发送时间戳
+ * @return 表项指针，槽位仍被占用时返回NULL
+ */
+struct probe_entry *probe_table_add(struct probe_table *table, uint16_t ident, uint16_t seq, double sending_ts);
+
+/**
+ * @brief 将应答对应到等待中的探测包，并记录应答信息
+ * @param table 分发表
+ * @param info 解析后的应答
+ * @return 匹配到的表项，没有匹配返回NULL（重复或过期的应答）
+ */
+struct probe_entry *probe_table_match(struct probe_table *table, const struct icmp_reply_info *info);
+
+/**
+ * @brief 取出一个等待超时的探测包，并标记为 PROBE_TIMEOUT
+ * @param table 分发表
+ * @param sent_before 发送时间早于该时间戳的探测包视为超时
+ * @return 超时的表项，没有返回NULL
+ */
+struct probe_entry *probe_table_expire(struct probe_table *table, double sent_before);
+
+/**
+ * @brief 将应答的 ICMP 类型映射为 ping 状态
+ * @param type ICMP 类型
+ * @return PING_STATUS_*
+ */
+int ping_status_from_icmp(uint8_t type);
+
+/**
+ * @brief 获取 ping 状态的名称
+ * @param status PING_STATUS_*
+ * @return 状态名称字符串
  */
-struct ping_result recv_echo_reply(int sock, int ident);
+const char *ping_status_str(int status);
 
 /**
  * @brief 发送 ICMP Ping 请求
@@ -1,64 +1,228 @@
+#include <sys/stat.h>
+
 #include "http_server.h"
 #include "icmp_ping.h"
+#include "config.h"
+#include "scheduler.h"
+
+static volatile sig_atomic_t reload_requested = 0; // 收到 SIGHUP
 
-int main()
+static void handle_sighup(int sig)
 {
-    int server_socket, client_socket;
-    struct sockaddr_in server_addr, client_addr;
-    socklen_t client_addr_len = sizeof(client_addr);
+    (void)sig;
+    reload_requested = 1;
+}
+
+/*
+ * 创建监听套接字，失败返回-1
+ */
+static int open_listener(int port, int backlog)
+{
+    struct sockaddr_in server_addr;
 
     // 创建套接字
-    server_socket = socket(AF_INET, SOCK_STREAM, 0);
+    int server_socket = socket(AF_INET, SOCK_STREAM, 0);
     if (server_socket < 0)
     {
         perror("Failed to create socket");
-        exit(EXIT_FAILURE);
+        return -1;
     }
 
     // 设置服务器地址结构
     memset(&server_addr, 0, sizeof(server_addr));
     server_addr.sin_family = AF_INET;
     server_addr.sin_addr.s_addr = INADDR_ANY;
-    server_addr.sin_port = htons(PORT);
+    server_addr.sin_port = htons(port);
 
     // 设置套接字选项避免地址使用错误
     int on = 1; // 允许地址重用, 0禁止地址重用
     if ((setsockopt(server_socket, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on))) < 0)
     {
         perror("setsockopt failed");
-        exit(EXIT_FAILURE);
+        close(server_socket);
+        return -1;
     }
 
     // 将套接字绑定到指定端口
     if (bind(server_socket, (struct sockaddr *)&server_addr, sizeof(server_addr)) < 0)
     {
         perror("Failed to bind socket");
-        exit(EXIT_FAILURE);
+        close(server_socket);
+        return -1;
     }
 
     // 监听连接请求
-    if (listen(server_socket, MAX_CONNECTIONS) < 0)
+    if (listen(server_socket, backlog) < 0)
     {
         perror("Failed to listen for connections");
+        close(server_socket);
+        return -1;
+    }
+
+    return server_socket;
+}
+
+/*
+ * 将配置应用到各模块，持续探测目标只增删有变化的部分
+ */
+static void apply_config(const struct server_config *config)
+{
+    icmp_ping_set_options(config->magic, config->recv_timeout_usec, config->ping_interval_ms);
+    http_server_set_max_results(config->max_results);
+    scheduler_apply(config->targets, config->targets_len);
+
+    struct scheduler_stats stats;
+    scheduler_get_stats(&stats);
+    printf("Applied config: %d targets (added %d, removed %d, changed %d) in %.3f ms\n",
+           stats.targets, stats.last_added, stats.last_removed, stats.last_changed, stats.last_apply_ms);
+    fflush(stdout);
+}
+
+/*
+ * 重新加载配置文件，读取失败时保留当前配置
+ */
+static void reload_config(const char *path, struct server_config *config, int *server_socket)
+{
+    struct server_config next;
+    if (config_load(path, &next) != 0)
+    {
+        fprintf(stderr, "Failed to reload %s, keeping current config\n", path);
+        return;
+    }
+
+    // 端口变化时换用新的监听套接字，绑定失败则继续使用原端口
+    if (next.port != config->port)
+    {
+        int server_socket_next = open_listener(next.port, next.max_connections);
+        if (server_socket_next >= 0)
+        {
+            close(*server_socket);
+            *server_socket = server_socket_next;
+        }
+        else
+        {
+            next.port = config->port;
+        }
+    }
+    if (next.port == config->port && next.max_connections != config->max_connections)
+    {
+        listen(*server_socket, next.max_connections); // 对已监听的套接字再次 listen 只修改队列长度
+    }
+
+    apply_config(&next);
+    config_free(config);
+    *config = next;
+}
+
+/*
+ * 配置文件是否被修改（包括被替换为新文件）
+ */
+static int config_changed(const char *path, struct stat *last)
+{
+    struct stat st;
+    if (stat(path, &st) != 0)
+    {
+        return 0;
+    }
+    int changed = st.st_ino != last->st_ino || st.st_size != last->st_size ||
+                  st.st_mtim.tv_sec != last->st_mtim.tv_sec || st.st_mtim.tv_nsec != last->st_mtim.tv_nsec;
+    *last = st;
+    return changed;
+}
+
+int main(int argc, char *argv[])
+{
+    const char *config_path = argc > 1 ? argv[1] : CONFIG_DEFAULT_PATH;
+    struct sockaddr_in client_addr;
+    socklen_t client_addr_len = sizeof(client_addr);
+
+    // 初始化发包限速
+    pacer_init(PACER_GLOBAL_PPS, PACER_GLOBAL_BURST, PACER_PREFIX_PPS, PACER_PREFIX_BURST);
+
+    // 预分配对象池，运行期间不再动态分配内存
+    if (icmp_ping_init() != 0 || http_server_init() != 0 || scheduler_init() != 0)
+    {
+        fprintf(stderr, "Failed to allocate memory pools\n");
         exit(EXIT_FAILURE);
     }
 
-    // 接受连接并处理请求
+    // 读取配置文件，不存在或有错误时使用默认值
+    struct server_config config;
+    struct stat config_stat;
+    bzero(&config_stat, sizeof(config_stat));
+    config_changed(config_path, &config_stat);
+    if (config_load(config_path, &config) != 0)
+    {
+        fprintf(stderr, "Failed to load %s, using defaults\n", config_path);
+        config_defaults(&config);
+    }
+    apply_config(&config);
+
+    int server_socket = open_listener(config.port, config.max_connections);
+    if (server_socket < 0)
+    {
+        exit(EXIT_FAILURE);
+    }
+
+    // SIGHUP 触发重新加载，不设置 SA_RESTART 以便打断 poll
+    struct sigaction action;
+    bzero(&action, sizeof(action));
+    action.sa_handler = handle_sighup;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGHUP, &action, NULL);
+
+    // 单线程事件循环：接受连接、收发持续探测包、检查配置文件；
+    // 处理 ping/traceroute 请求期间由 icmp_wait_readable 继续执行持续探测
+    icmp_set_background(scheduler_fd(), scheduler_pump);
+    double next_check = get_timestamp() + CONFIG_CHECK_INTERVAL_SEC;
     while (1)
     {
-        client_socket = accept(server_socket, (struct sockaddr *)&client_addr, &client_addr_len);
-        if (client_socket < 0)
+        int timeout_ms = 1000;
+        double next_event = scheduler_pump();
+        if (next_event != 0)
         {
-            perror("Failed to accept connection");
-            continue;
+            double wait_ms = (next_event - get_timestamp()) * 1000;
+            timeout_ms = wait_ms <= 0 ? 0 : wait_ms < 1000 ? (int)wait_ms + 1 : 1000;
         }
 
-        handle_client(client_socket);
+        // 持续探测的应答在下一轮循环开始时由 scheduler_pump 读取
+        struct pollfd fds[2] = {{server_socket, POLLIN, 0}, {scheduler_fd(), POLLIN, 0}};
+        if (poll(fds, 2, timeout_ms) < 0 && errno != EINTR)
+        {
+            perror("poll failed");
+        }
 
-        close(client_socket);
+        if (fds[0].revents & POLLIN)
+        {
+            int client_socket = accept(server_socket, (struct sockaddr *)&client_addr, &client_addr_len);
+            if (client_socket < 0)
+            {
+                perror("Failed to accept connection");
+            }
+            else
+            {
+                handle_client(client_socket);
+            }
+        }
+
+        double now = get_timestamp();
+        if (now >= next_check)
+        {
+            next_check = now + CONFIG_CHECK_INTERVAL_SEC;
+            if (config_changed(config_path, &config_stat))
+            {
+                reload_requested = 1;
+            }
+        }
+        if (reload_requested)
+        {
+            reload_requested = 0;
+            reload_config(config_path, &config, &server_socket);
+        }
     }
 
     close(server_socket);
+    config_free(&config);
 
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,157 @@
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <arpa/inet.h>
+
+#include "icmp_ping.h"
+#include "pacer.h"
+
+/**
+ * @brief 网段令牌桶表项
+ */
+struct prefix_bucket
+{
+    uint32_t prefix; /**< 网段（主机字节序），0 表示空闲 */
+    struct token_bucket bucket;
+};
+
+static struct token_bucket global_bucket;
+static struct prefix_bucket prefix_buckets[PACER_PREFIX_SLOTS];
+static double prefix_interval;
+static double prefix_tau;
+static struct pacer_stats stats;
+
+// 按发送时间（毫秒）计数的时间轮，统计推迟发送的包数
+static struct
+{
+    int64_t ms;     // 槽位对应的毫秒时间戳
+    uint32_t count; // 该毫秒内预约发送的包数
+} backlog_wheel[PACER_BACKLOG_SLOTS];
+
+static void bucket_init(struct token_bucket *bucket, double pps, int burst)
+{
+    bucket->interval = 1.0 / pps;
+    bucket->tau = (burst > 1 ? burst - 1 : 0) * bucket->interval;
+    bucket->tat = 0;
+}
+
+/*
+ * 最早可以发送的时间，不修改令牌桶
+ */
+static double bucket_earliest(const struct token_bucket *bucket, double now)
+{
+    double ts = bucket->tat - bucket->tau;
+    return ts > now ? ts : now;
+}
+
+/*
+ * 在 send_ts 发送一个包，推进理论到达时间，间隔加入均值为0的随机抖动
+ */
+static void bucket_commit(struct token_bucket *bucket, double send_ts)
+{
+    double jitter = PACER_JITTER * (2.0 * rand() / RAND_MAX - 1.0);
+    double base = bucket->tat > send_ts ? bucket->tat : send_ts;
+    bucket->tat = base + bucket->interval * (1.0 + jitter);
+}
+
+/*
+ * 查找网段对应的令牌桶：优先命中相同网段，其次复用空闲的槽位（tat 已过期的桶和新桶等价）
+ */
+static struct token_bucket *prefix_lookup(uint32_t prefix, double now)
+{
+    uint32_t hash = (prefix >> (32 - PACER_PREFIX_LEN)) * 2654435761u;
+    struct prefix_bucket *victim = NULL;
+    for (int i = 0; i < PACER_PREFIX_PROBES; i++)
+    {
+        struct prefix_bucket *slot = &prefix_buckets[(hash + i) & (PACER_PREFIX_SLOTS - 1)];
+        if (slot->prefix == prefix)
+        {
+            return &slot->bucket;
+        }
+        if (victim == NULL || slot->bucket.tat < victim->bucket.tat)
+        {
+            victim = slot;
+        }
+    }
+
+    // 没有命中时淘汰理论到达时间最早的槽位
+    victim->prefix = prefix;
+    victim->bucket.interval = prefix_interval;
+    victim->bucket.tau = prefix_tau;
+    if (victim->bucket.tat > now)
+    {
+        victim->bucket.tat = now;
+    }
+    return &victim->bucket;
+}
+
+void pacer_init(double global_pps, int global_burst, double prefix_pps, int prefix_burst)
+{
+    bucket_init(&global_bucket, global_pps, global_burst);
+
+    struct token_bucket prefix_template;
+    bucket_init(&prefix_template, prefix_pps, prefix_burst);
+    prefix_interval = prefix_template.interval;
+    prefix_tau = prefix_template.tau;
+
+    bzero(prefix_buckets, sizeof(prefix_buckets));
+    bzero(backlog_wheel, sizeof(backlog_wheel));
+    bzero(&stats, sizeof(stats));
+    srand(time(NULL));
+}
+
+double pacer_reserve(struct in_addr dst, double now)
+{
+    if (global_bucket.interval == 0)
+    {
+        pacer_init(PACER_GLOBAL_PPS, PACER_GLOBAL_BURST, PACER_PREFIX_PPS, PACER_PREFIX_BURST);
+    }
+
+    uint32_t mask = PACER_PREFIX_LEN == 0 ? 0 : 0xffffffffu << (32 - PACER_PREFIX_LEN);
+    uint32_t prefix = (ntohl(dst.s_addr) & mask) | 1; // 最低位置1，区分空闲槽位
+    struct token_bucket *bucket = prefix_lookup(prefix, now);
+
+    // 发送时间同时满足网段和全局限速
+    double global_ts = bucket_earliest(&global_bucket, now);
+    double send_ts = bucket_earliest(bucket, global_ts);
+    if (send_ts - now > PACER_MAX_WAIT_SEC)
+    {
+        stats.dropped++;
+        return -1;
+    }
+
+    // 全局令牌按自己的理论到达时间消耗，网段推迟的包不会把全局时间推后而空出间隙
+    bucket_commit(bucket, send_ts);
+    bucket_commit(&global_bucket, global_ts);
+    stats.sent++;
+    if (send_ts > now)
+    {
+        stats.delayed++;
+        int64_t ms = (int64_t)(send_ts * 1000);
+        int slot = ms & (PACER_BACKLOG_SLOTS - 1);
+        if (backlog_wheel[slot].ms != ms)
+        {
+            backlog_wheel[slot].ms = ms;
+            backlog_wheel[slot].count = 0;
+        }
+        backlog_wheel[slot].count++;
+    }
+    return send_ts;
+}
+
+void pacer_get_stats(struct pacer_stats *out)
+{
+    *out = stats;
+
+    // 发送时间还没到的预约
+    int64_t now_ms = (int64_t)(get_timestamp() * 1000);
+    uint64_t backlog = 0;
+    for (int i = 0; i < PACER_BACKLOG_SLOTS; i++)
+    {
+        if (backlog_wheel[i].ms > now_ms)
+        {
+            backlog += backlog_wheel[i].count;
+        }
+    }
+    out->backlog = backlog;
+}
@@ -0,0 +1,63 @@
+#ifndef PACER_H
+#define PACER_H
+
+#include <stdint.h>
+#include <netinet/in.h>
+
+#define PACER_GLOBAL_PPS 10000  /**< 全局发包速率上限（包/秒） */
+#define PACER_GLOBAL_BURST 1    /**< 全局令牌桶容量，为1时发包完全均匀分布 */
+#define PACER_PREFIX_PPS 1000   /**< 每个目标网段的发包速率上限（包/秒） */
+#define PACER_PREFIX_BURST 1    /**< 每个目标网段的令牌桶容量 */
+#define PACER_PREFIX_LEN 24     /**< 目标网段的前缀长度 */
+#define PACER_PREFIX_SLOTS 1024 /**< 网段令牌桶表容量（必须为2的幂） */
+#define PACER_PREFIX_PROBES 8   /**< 网段令牌桶表的最大探查次数 */
+#define PACER_JITTER 0.1        /**< 发包间隔的随机抖动比例，平均间隔不变 */
+#define PACER_MAX_WAIT_SEC 1.0  /**< 需要排队超过该时间的发包直接丢弃 */
+#define PACER_BACKLOG_SLOTS 2048 /**< 统计排队包数的时间轮槽位数（每槽1毫秒，必须为2的幂，且覆盖 PACER_MAX_WAIT_SEC） */
+
+/**
+ * @brief 令牌桶，按 GCRA（虚拟调度）实现：tat 为下一个包的理论发送时间
+ */
+struct token_bucket
+{
+    double interval; /**< 发包间隔（秒），速率的倒数 */
+    double tau;      /**< 允许提前发送的时间（秒），即 (burst - 1) * interval */
+    double tat;      /**< 理论到达时间 */
+};
+
+/**
+ * @brief 发包调度统计
+ */
+struct pacer_stats
+{
+    uint64_t sent;    /**< 预约成功的包数 */
+    uint64_t delayed; /**< 预约的发送时间晚于预约时刻、由调用者推迟发送的包数 */
+    uint64_t dropped; /**< 因需要排队超过 PACER_MAX_WAIT_SEC 被丢弃的包数 */
+    double backlog;   /**< 已预约、尚未到发送时间的包数 */
+};
+
+/**
+ * @brief 初始化全局和网段发包调度
+ * @param global_pps 全局速率（包/秒）
+ * @param global_burst 全局令牌桶容量
+ * @param prefix_pps 每个网段速率（包/秒）
+ * @param prefix_burst 每个网段令牌桶容量
+ */
+void pacer_init(double global_pps, int global_burst, double prefix_pps, int prefix_burst);
+
+/**
+ * @brief 为发往 dst 的一个包预约发送时间，不阻塞：调用者在返回的时间之前推迟发送
+ *        （持续探测放回事件堆，ping/traceroute 等待期间继续收包）
+ * @param dst 目标地址
+ * @param now 当前时间戳
+ * @return 允许发送的时间戳，需要排队超过 PACER_MAX_WAIT_SEC 时返回-1（丢弃，不消耗令牌）
+ */
+double pacer_reserve(struct in_addr dst, double now);
+
+/**
+ * @brief 获取发包调度统计
+ * @param stats 统计结果
+ */
+void pacer_get_stats(struct pacer_stats *stats);
+
+#endif /* PACER_H */
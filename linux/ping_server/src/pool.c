@@ -0,0 +1,121 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "pool.h"
+
+static const struct object_pool *pools[POOL_MAX_POOLS];
+static int pools_count = 0;
+static struct arena_stats arena_stats;
+
+static size_t align_up(size_t size)
+{
+    return (size + POOL_ALIGN - 1) & ~(size_t)(POOL_ALIGN - 1);
+}
+
+int pool_init(struct object_pool *pool, const char *name, size_t object_size, int capacity)
+{
+    pool->name = name;
+    pool->object_size = align_up(object_size < sizeof(void *) ? sizeof(void *) : object_size);
+    pool->capacity = capacity;
+    pool->in_use = 0;
+    pool->peak = 0;
+    pool->allocs = 0;
+    pool->failures = 0;
+    pool->memory = malloc(pool->object_size * capacity);
+    if (pool->memory == NULL)
+    {
+        perror("allocate pool");
+        return -1;
+    }
+
+    // 把所有对象串成空闲链表
+    pool->free_list = NULL;
+    for (int i = capacity - 1; i >= 0; i--)
+    {
+        void **object = (void **)(pool->memory + i * pool->object_size);
+        *object = pool->free_list;
+        pool->free_list = object;
+    }
+
+    if (pools_count < POOL_MAX_POOLS)
+    {
+        pools[pools_count++] = pool;
+    }
+    return 0;
+}
+
+void *pool_alloc(struct object_pool *pool)
+{
+    void **object = pool->free_list;
+    if (object == NULL)
+    {
+        pool->failures++;
+        return NULL;
+    }
+
+    pool->free_list = *object;
+    pool->in_use++;
+    pool->allocs++;
+    if (pool->in_use > pool->peak)
+    {
+        pool->peak = pool->in_use;
+    }
+    return object;
+}
+
+void pool_free(struct object_pool *pool, void *object)
+{
+    if (object == NULL)
+    {
+        return;
+    }
+
+    *(void **)object = pool->free_list;
+    pool->free_list = object;
+    pool->in_use--;
+}
+
+int pool_count()
+{
+    return pools_count;
+}
+
+const struct object_pool *pool_get(int index)
+{
+    return pools[index];
+}
+
+void arena_init(struct arena *arena, void *memory, size_t size)
+{
+    arena->base = memory;
+    arena->size = size;
+    arena->used = 0;
+}
+
+void *arena_alloc(struct arena *arena, size_t size)
+{
+    size = align_up(size);
+    if (size > arena->size - arena->used)
+    {
+        arena_stats.failures++;
+        return NULL;
+    }
+
+    void *memory = arena->base + arena->used;
+    arena->used += size;
+    if (arena->used > arena_stats.peak)
+    {
+        arena_stats.peak = arena->used;
+    }
+    return memory;
+}
+
+void arena_reset(struct arena *arena)
+{
+    arena->used = 0;
+}
+
+void arena_get_stats(struct arena_stats *stats)
+{
+    *stats = arena_stats;
+}
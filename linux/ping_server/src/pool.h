@@ -0,0 +1,110 @@
+#ifndef POOL_H
+#define POOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define POOL_MAX_POOLS 8 /**< 可登记统计的对象池个数 */
+#define POOL_ALIGN 16    /**< 对象和 arena 分配的对齐字节数 */
+
+/**
+ * @brief 固定容量对象池，内存在初始化时一次性分配，空闲对象组成单链表，分配和释放均为 O(1)
+ */
+struct object_pool
+{
+    const char *name;     /**< 名称，用于统计输出 */
+    unsigned char *memory; /**< 对象内存 */
+    void *free_list;      /**< 空闲对象链表 */
+    size_t object_size;   /**< 对齐后的对象大小 */
+    int capacity;         /**< 容量 */
+    int in_use;           /**< 正在使用的对象数 */
+    int peak;             /**< 同时使用的最大对象数 */
+    uint64_t allocs;      /**< 分配次数 */
+    uint64_t failures;    /**< 池耗尽导致的分配失败次数 */
+};
+
+/**
+ * @brief 线性分配器，用于单个请求的临时数据，请求结束时一次性释放
+ */
+struct arena
+{
+    unsigned char *base; /**< 内存起始地址 */
+    size_t size;         /**< 内存大小 */
+    size_t used;         /**< 已分配字节数 */
+};
+
+/**
+ * @brief arena 统计（所有 arena 共享）
+ */
+struct arena_stats
+{
+    size_t peak;       /**< 单个 arena 的最大使用字节数 */
+    uint64_t failures; /**< 空间不足导致的分配失败次数 */
+};
+
+/**
+ * @brief 初始化对象池并预分配全部内存，同时登记到统计列表
+ * @param pool 对象池
+ * @param name 名称
+ * @param object_size 对象大小
+ * @param capacity 容量
+ * @return 成功返回0，失败返回-1
+ */
+int pool_init(struct object_pool *pool, const char *name, size_t object_size, int capacity);
+
+/**
+ * @brief 从对象池中取出一个对象（内容未清零）
+ * @param pool 对象池
+ * @return 对象指针，池耗尽时返回NULL
+ */
+void *pool_alloc(struct object_pool *pool);
+
+/**
+ * @brief 归还对象
+ * @param pool 对象池
+ * @param object 由 pool_alloc 取出的对象，NULL 时忽略
+ */
+void pool_free(struct object_pool *pool, void *object);
+
+/**
+ * @brief 获取已登记的对象池个数
+ * @return 对象池个数
+ */
+int pool_count();
+
+/**
+ * @brief 获取已登记的对象池（用于输出统计）
+ * @param index 下标
+ * @return 对象池
+ */
+const struct object_pool *pool_get(int index);
+
+/**
+ * @brief 初始化 arena
+ * @param arena arena
+ * @param memory 由调用者提供的内存
+ * @param size 内存大小
+ */
+void arena_init(struct arena *arena, void *memory, size_t size);
+
+/**
+ * @brief 从 arena 分配内存
+ * @param arena arena
+ * @param size 字节数
+ * @return 内存指针，空间不足时返回NULL
+ */
+void *arena_alloc(struct arena *arena, size_t size);
+
+/**
+ * @brief 一次性释放 arena 中的全部分配
+ * @param arena arena
+ */
+void arena_reset(struct arena *arena);
+
+/**
+ * @brief 获取 arena 统计
+ * @param stats 统计结果
+ */
+void arena_get_stats(struct arena_stats *stats);
+
+#endif /* POOL_H */
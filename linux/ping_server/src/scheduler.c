@@ -0,0 +1,454 @@
+#include "scheduler.h"
+
+static struct object_pool target_pool;      // 目标对象
+static struct sched_target **heap;          // 按 next_event 排列的小根堆
+static int heap_len = 0;
+static struct sched_target **hash_slots;    // 地址索引（线性探测）
+static struct sched_target **sorted;        // 按地址排序的当前目标
+static struct sched_target **sorted_next;   // 应用配置时使用的另一份数组
+static int sorted_len = 0;
+static unsigned char *recv_buffer;          // 接收缓冲区
+static int sock = -1;
+static uint16_t ident;
+static struct scheduler_stats stats;
+
+static uint32_t hash_addr(struct in_addr addr)
+{
+    // 乘法散列取高位，相邻地址分散到不同槽位
+    return (ntohl(addr.s_addr) * 2654435761u) >> (32 - SCHEDULER_HASH_BITS);
+}
+
+static struct sched_target *hash_find(struct in_addr addr)
+{
+    for (uint32_t i = hash_addr(addr); hash_slots[i] != NULL; i = (i + 1) & (SCHEDULER_HASH_SIZE - 1))
+    {
+        if (hash_slots[i]->addr.s_addr == addr.s_addr)
+        {
+            return hash_slots[i];
+        }
+    }
+    return NULL;
+}
+
+static void hash_insert(struct sched_target *target)
+{
+    uint32_t i = hash_addr(target->addr);
+    while (hash_slots[i] != NULL)
+    {
+        i = (i + 1) & (SCHEDULER_HASH_SIZE - 1);
+    }
+    hash_slots[i] = target;
+}
+
+/*
+ * 删除后把同一探测链上的后续项前移，不使用墓碑标记
+ */
+static void hash_remove(struct sched_target *target)
+{
+    uint32_t i = hash_addr(target->addr);
+    while (hash_slots[i] != target)
+    {
+        i = (i + 1) & (SCHEDULER_HASH_SIZE - 1);
+    }
+    hash_slots[i] = NULL;
+
+    for (uint32_t j = (i + 1) & (SCHEDULER_HASH_SIZE - 1); hash_slots[j] != NULL; j = (j + 1) & (SCHEDULER_HASH_SIZE - 1))
+    {
+        // 理想位置 k 不在 (i, j] 之间时，j 上的项可以移到 i
+        uint32_t k = hash_addr(hash_slots[j]->addr);
+        int in_range = i <= j ? (k > i && k <= j) : (k > i || k <= j);
+        if (!in_range)
+        {
+            hash_slots[i] = hash_slots[j];
+            hash_slots[j] = NULL;
+            i = j;
+        }
+    }
+}
+
+static void heap_set(int index, struct sched_target *target)
+{
+    heap[index] = target;
+    target->heap_index = index;
+}
+
+static void heap_sift_up(int index)
+{
+    struct sched_target *target = heap[index];
+    while (index > 0 && heap[(index - 1) / 2]->next_event > target->next_event)
+    {
+        heap_set(index, heap[(index - 1) / 2]);
+        index = (index - 1) / 2;
+    }
+    heap_set(index, target);
+}
+
+static void heap_sift_down(int index)
+{
+    struct sched_target *target = heap[index];
+    for (;;)
+    {
+        int child = 2 * index + 1;
+        if (child >= heap_len)
+        {
+            break;
+        }
+        if (child + 1 < heap_len && heap[child + 1]->next_event < heap[child]->next_event)
+        {
+            child++;
+        }
+        if (heap[child]->next_event >= target->next_event)
+        {
+            break;
+        }
+        heap_set(index, heap[child]);
+        index = child;
+    }
+    heap_set(index, target);
+}
+
+static void heap_push(struct sched_target *target)
+{
+    heap_set(heap_len++, target);
+    heap_sift_up(target->heap_index);
+}
+
+static void heap_remove(struct sched_target *target)
+{
+    int index = target->heap_index;
+    struct sched_target *last = heap[--heap_len];
+    if (index == heap_len)
+    {
+        return;
+    }
+    heap_set(index, last);
+    heap_sift_up(index);
+    heap_sift_down(last->heap_index);
+}
+
+static void heap_update(struct sched_target *target)
+{
+    heap_sift_up(target->heap_index);
+    heap_sift_down(target->heap_index);
+}
+
+/*
+ * 单个探测包的超时时间，不超过探测间隔
+ */
+static double probe_timeout(const struct sched_target *target)
+{
+    double interval = target->interval_ms / 1000.0;
+    return interval < PING_TIMEOUT_SEC ? interval : PING_TIMEOUT_SEC;
+}
+
+static void update_next_event(struct sched_target *target)
+{
+    target->next_event = target->reserved_ts != 0 ? target->reserved_ts : target->next_send;
+    if (target->pending && target->sending_ts + probe_timeout(target) < target->next_event)
+    {
+        target->next_event = target->sending_ts + probe_timeout(target);
+    }
+}
+
+static void record(struct sched_target *target, uint8_t status, double time)
+{
+    target->history[target->history_pos].status = status;
+    target->history[target->history_pos].time = time;
+    target->history_pos = (target->history_pos + 1) % SCHEDULER_HISTORY;
+    if (target->history_len < SCHEDULER_HISTORY)
+    {
+        target->history_len++;
+    }
+}
+
+static void send_probe(struct sched_target *target)
+{
+    struct sockaddr_in addr;
+    bzero(&addr, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr = target->addr;
+
+    target->seq = target->seq == 0xffff ? 1 : target->seq + 1;
+    if (send_echo_request(sock, &addr, ident, target->seq) != 0)
+    {
+        // sendto 失败（例如没有路由），记为未发送
+        record(target, PING_STATUS_DROPPED, 0);
+        stats.dropped++;
+        return;
+    }
+
+    target->sending_ts = get_timestamp();
+    target->pending = 1;
+    target->sent++;
+    stats.sent++;
+}
+
+static struct sched_target *add_target(const struct config_target *config, double now)
+{
+    struct sched_target *target = pool_alloc(&target_pool);
+    bzero(target, sizeof(*target));
+    target->addr.s_addr = htonl(config->addr);
+    target->interval_ms = config->interval_ms;
+
+    // 新目标的首次发送在一个间隔内随机分布，避免同时加载大量目标时集中发包
+    target->next_send = now + config->interval_ms / 1000.0 * rand() / RAND_MAX;
+    update_next_event(target);
+    heap_push(target);
+    hash_insert(target);
+    return target;
+}
+
+static void remove_target(struct sched_target *target)
+{
+    heap_remove(target);
+    hash_remove(target);
+    pool_free(&target_pool, target);
+}
+
+static void change_interval(struct sched_target *target, uint32_t interval_ms, double now)
+{
+    target->interval_ms = interval_ms;
+    if (target->sent > 0)
+    {
+        // 按新间隔从上一次发送起算，进行中的探测不受影响
+        target->next_send = target->sending_ts + interval_ms / 1000.0;
+        if (target->next_send < now)
+        {
+            target->next_send = now;
+        }
+    }
+    else
+    {
+        target->next_send = now + interval_ms / 1000.0 * rand() / RAND_MAX;
+    }
+    update_next_event(target);
+    heap_update(target);
+}
+
+int scheduler_init()
+{
+    heap = malloc(sizeof(struct sched_target *) * SCHEDULER_MAX_TARGETS);
+    hash_slots = calloc(SCHEDULER_HASH_SIZE, sizeof(struct sched_target *));
+    sorted = malloc(sizeof(struct sched_target *) * SCHEDULER_MAX_TARGETS);
+    sorted_next = malloc(sizeof(struct sched_target *) * SCHEDULER_MAX_TARGETS);
+    recv_buffer = malloc(IP_BUFFER_SIZE);
+    if (heap == NULL || hash_slots == NULL || sorted == NULL || sorted_next == NULL || recv_buffer == NULL)
+    {
+        perror("allocate scheduler");
+        return -1;
+    }
+    if (pool_init(&target_pool, "sched_target", sizeof(struct sched_target), SCHEDULER_MAX_TARGETS) != 0)
+    {
+        return -1;
+    }
+
+    ident = icmp_ident_reserved();
+    sock = icmp_socket_open(ident);
+    if (sock == -1)
+    {
+        return -1;
+    }
+    return 0;
+}
+
+int scheduler_apply(const struct config_target *targets, int len)
+{
+    double start = get_timestamp();
+    if (len > SCHEDULER_MAX_TARGETS)
+    {
+        fprintf(stderr, "too many targets: %d, only the first %d are probed\n", len, SCHEDULER_MAX_TARGETS);
+        len = SCHEDULER_MAX_TARGETS;
+    }
+
+    // 第一遍：删除不再出现的目标，先释放对象再新增，保证对象池不会暂时超出容量
+    int removed = 0;
+    int kept = 0;
+    int j = 0;
+    for (int i = 0; i < sorted_len; i++)
+    {
+        uint32_t addr = ntohl(sorted[i]->addr.s_addr);
+        while (j < len && targets[j].addr < addr)
+        {
+            j++;
+        }
+        if (j < len && targets[j].addr == addr)
+        {
+            sorted[kept++] = sorted[i];
+        }
+        else
+        {
+            remove_target(sorted[i]);
+            removed++;
+        }
+    }
+
+    // 第二遍：归并，新增目标，修改间隔有变化的目标，其余原样保留
+    int added = 0;
+    int changed = 0;
+    int out = 0;
+    int i = 0;
+    for (j = 0; j < len; j++)
+    {
+        if (i < kept && ntohl(sorted[i]->addr.s_addr) == targets[j].addr)
+        {
+            if (sorted[i]->interval_ms != targets[j].interval_ms)
+            {
+                change_interval(sorted[i], targets[j].interval_ms, start);
+                changed++;
+            }
+            sorted_next[out++] = sorted[i++];
+        }
+        else
+        {
+            sorted_next[out++] = add_target(&targets[j], start);
+            added++;
+        }
+    }
+
+    struct sched_target **swap = sorted;
+    sorted = sorted_next;
+    sorted_next = swap;
+    sorted_len = out;
+
+    stats.targets = sorted_len;
+    stats.reloads++;
+    stats.last_added = added;
+    stats.last_removed = removed;
+    stats.last_changed = changed;
+    stats.last_apply_ms = (get_timestamp() - start) * 1000;
+    return 0;
+}
+
+int scheduler_fd()
+{
+    return sock;
+}
+
+double scheduler_next_event()
+{
+    return heap_len > 0 ? heap[0]->next_event : 0;
+}
+
+int scheduler_run()
+{
+    double now = get_timestamp();
+    for (int n = 0; heap_len > 0 && heap[0]->next_event <= now; n++)
+    {
+        if (n >= SCHEDULER_BATCH)
+        {
+            return 1;
+        }
+
+        struct sched_target *target = heap[0];
+        if (target->pending && now >= target->sending_ts + probe_timeout(target))
+        {
+            record(target, PING_STATUS_TIMEOUT, 0);
+            target->pending = 0;
+            stats.timeouts++;
+        }
+        if (now >= target->next_send)
+        {
+            // 向发包调度预约发送时间，未到时间时放回堆中推迟到该时间，不阻塞主循环
+            double send_ts = target->reserved_ts != 0 ? target->reserved_ts : pacer_reserve(target->addr, now);
+            target->reserved_ts = 0;
+            if (send_ts > now)
+            {
+                target->reserved_ts = send_ts;
+            }
+            else
+            {
+                // 超时等于间隔时，发送时刻通常还没到上一个探测包的超时时间，下一次发送前结算为超时
+                if (target->pending)
+                {
+                    record(target, PING_STATUS_TIMEOUT, 0);
+                    target->pending = 0;
+                    stats.timeouts++;
+                }
+                if (send_ts < 0)
+                {
+                    // 排队过久被发包调度丢弃
+                    record(target, PING_STATUS_DROPPED, 0);
+                    stats.dropped++;
+                }
+                else
+                {
+                    send_probe(target);
+                }
+                // 保持固定节奏，落后超过一个间隔时不补发
+                target->next_send += target->interval_ms / 1000.0;
+                if (target->next_send <= now)
+                {
+                    target->next_send = now + target->interval_ms / 1000.0;
+                }
+            }
+        }
+        update_next_event(target);
+        heap_sift_down(0);
+        now = get_timestamp();
+    }
+    return 0;
+}
+
+void scheduler_recv()
+{
+    for (;;)
+    {
+        double recv_ts;
+        int bytes = icmp_recv(sock, recv_buffer, IP_BUFFER_SIZE, &recv_ts);
+        if (bytes == -1)
+        {
+            return;
+        }
+
+        // 按原始请求的目标地址找到目标，seq 必须是最近一次发送的
+        struct icmp_reply_info info;
+        if (parse_icmp_reply(recv_buffer, bytes, &info) != 0 || info.ident != ident)
+        {
+            continue;
+        }
+        if (info.type == ICMP_ECHOREPLY && info.code != 0)
+        {
+            continue;
+        }
+        struct sched_target *target = hash_find(info.target);
+        if (target == NULL || !target->pending || target->seq != info.seq)
+        {
+            continue;
+        }
+
+        // sending_ts 在 sendto 返回后记录，本机目标的应答可能更早到达
+        int status = ping_status_from_icmp(info.type);
+        record(target, status, recv_ts > target->sending_ts ? (recv_ts - target->sending_ts) * 1000 : 0);
+        target->pending = 0;
+        if (status == PING_STATUS_OK)
+        {
+            target->received++;
+            stats.received++;
+        }
+        else
+        {
+            stats.errors++;
+        }
+    }
+}
+
+double scheduler_pump()
+{
+    // 应答可能在主循环或请求阻塞期间到达，必须在判断超时之前读取
+    scheduler_recv();
+    if (scheduler_run())
+    {
+        return get_timestamp();
+    }
+    return scheduler_next_event();
+}
+
+void scheduler_get_stats(struct scheduler_stats *out)
+{
+    *out = stats;
+}
+
+const struct sched_target *scheduler_target_at(int index)
+{
+    return index >= 0 && index < sorted_len ? sorted[index] : NULL;
+}
@@ -0,0 +1,116 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include "config.h"
+
+#define SCHEDULER_MAX_TARGETS 131072 /**< 持续探测目标的最大个数（启动时预分配） */
+#define SCHEDULER_HASH_BITS 18       /**< 地址索引槽位数的位数 */
+#define SCHEDULER_HASH_SIZE (1 << SCHEDULER_HASH_BITS) /**< 地址索引的槽位数（大于 SCHEDULER_MAX_TARGETS） */
+#define SCHEDULER_HISTORY 8          /**< 每个目标保留的最近探测结果个数 */
+#define SCHEDULER_BATCH 64           /**< 每次最多处理的到期事件数，避免长时间阻塞 HTTP 请求 */
+
+/**
+ * @brief 一次探测的结果
+ */
+struct probe_record
+{
+    float time;     /**< 往返时间 ms */
+    uint8_t status; /**< PING_STATUS_* */
+};
+
+/**
+ * @brief 持续探测的目标，从对象池分配，重新加载配置时未变化的目标原样保留（包括进行中的探测和历史）
+ */
+struct sched_target
+{
+    struct in_addr addr;   /**< 目标地址 */
+    uint32_t interval_ms;  /**< 探测间隔（毫秒） */
+    double next_send;      /**< 下一次发送时间 */
+    double reserved_ts;    /**< 向发包调度预约到的发送时间，晚于 next_send 时推迟到该时间发送，0 表示没有预约 */
+    double next_event;     /**< 下一次需要处理的时间（发送或超时），堆按此排序 */
+    double sending_ts;     /**< 最近一次发送时间 */
+    uint16_t seq;          /**< 最近一次发送的序列号 */
+    uint8_t pending;       /**< 最近一次发送是否在等待应答 */
+    int heap_index;        /**< 在事件堆中的下标 */
+    uint64_t sent;         /**< 发送次数 */
+    uint64_t received;     /**< 收到 Echo 应答的次数 */
+    int history_len;       /**< 历史记录个数 */
+    int history_pos;       /**< 下一条历史记录的位置 */
+    struct probe_record history[SCHEDULER_HISTORY]; /**< 最近的探测结果（环形） */
+};
+
+/**
+ * @brief 持续探测统计
+ */
+struct scheduler_stats
+{
+    int targets;           /**< 当前目标个数 */
+    uint64_t reloads;      /**< 应用配置的次数 */
+    double last_apply_ms;  /**< 最近一次应用配置的耗时（毫秒） */
+    int last_added;        /**< 最近一次新增的目标数 */
+    int last_removed;      /**< 最近一次删除的目标数 */
+    int last_changed;      /**< 最近一次修改了间隔的目标数 */
+    uint64_t sent;         /**< 发送总数 */
+    uint64_t received;     /**< Echo 应答总数 */
+    uint64_t errors;       /**< 差错报文总数 */
+    uint64_t timeouts;     /**< 超时总数 */
+    uint64_t dropped;      /**< 被发包调度丢弃的总数 */
+};
+
+/**
+ * @brief 启动时预分配目标对象池、事件堆和地址索引，并打开探测用的套接字
+ * @return 成功返回0，失败返回-1
+ */
+int scheduler_init();
+
+/**
+ * @brief 应用新的目标列表：与当前目标按地址归并比较，只新增、删除或修改有变化的目标
+ * @param targets 目标列表，按地址排序且去重
+ * @param len 目标个数，超过 SCHEDULER_MAX_TARGETS 的部分被忽略
+ * @return 成功返回0，失败返回-1
+ */
+int scheduler_apply(const struct config_target *targets, int len);
+
+/**
+ * @brief 获取探测用套接字，用于 poll
+ * @return 套接字描述符
+ */
+int scheduler_fd();
+
+/**
+ * @brief 获取下一个事件的时间
+ * @return 时间戳，没有目标时返回0
+ */
+double scheduler_next_event();
+
+/**
+ * @brief 处理到期的发送和超时事件（最多 SCHEDULER_BATCH 个）
+ * @return 还有到期事件未处理返回1，否则返回0
+ */
+int scheduler_run();
+
+/**
+ * @brief 读取并处理套接字中所有的应答
+ */
+void scheduler_recv();
+
+/**
+ * @brief 先读取已到达的应答，再处理到期事件，供主循环和 icmp_wait_readable 的后台任务调用
+ * @return 下一个事件的时间戳，还有到期事件未处理时为当前时间，没有目标时返回0
+ */
+double scheduler_pump();
+
+/**
+ * @brief 获取持续探测统计
+ * @param stats 统计结果
+ */
+void scheduler_get_stats(struct scheduler_stats *stats);
+
+/**
+ * @brief 按地址顺序获取第 index 个目标
+ * @param index 下标
+ * @return 目标，越界返回NULL
+ */
+const struct sched_target *scheduler_target_at(int index);
+
+#endif /* SCHEDULER_H */
@@ -0,0 +1,197 @@
+#include "traceroute.h"
+
+/*
+ * 接收并分发一个应答，更新目标所在跳数
+ * 返回值: 没有可读数据返回-1，否则返回0
+ */
+static int trace_recv(int sock, unsigned char *buffer, int size, struct probe_table *table, int ident, int *dest_ttl)
+{
+    double recv_ts;
+    int bytes = icmp_recv(sock, buffer, size, &recv_ts);
+    if (bytes == -1)
+    {
+        return -1;
+    }
+
+    struct icmp_reply_info info;
+    if (parse_icmp_reply(buffer, bytes, &info) != 0 || info.ident != ident)
+    {
+        return 0;
+    }
+    info.recv_ts = recv_ts;
+    struct probe_entry *entry = probe_table_match(table, &info);
+    if (entry == NULL)
+    {
+        return 0;
+    }
+
+    int ttl = (entry->seq - 1) % TRACE_MAX_HOPS + 1;
+    // Echo 应答或目标不可达都表示路径在这一跳结束
+    if ((entry->type == ICMP_ECHOREPLY || entry->type == ICMP_DEST_UNREACH) && ttl < *dest_ttl)
+    {
+        *dest_ttl = ttl;
+    }
+    return 0;
+}
+
+/*
+ * 目标及之前各跳是否还有等待应答的探测包
+ */
+static int trace_outstanding(const struct probe_table *table, int dest_ttl)
+{
+    for (int i = 0; i < PROBE_TABLE_SIZE; i++)
+    {
+        const struct probe_entry *e = &table->entries[i];
+        if (e->state == PROBE_PENDING && (e->seq - 1) % TRACE_MAX_HOPS + 1 <= dest_ttl)
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int traceroute(const char *ip, int max_hops, struct hop_result *hops, int *hop_count)
+{
+    if (max_hops <= 0 || max_hops > TRACE_MAX_HOPS)
+    {
+        fprintf(stderr, "bad max hops: %d\n", max_hops);
+        return -1;
+    }
+
+    struct sockaddr_in addr;
+    bzero(&addr, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = 0;
+    if (inet_aton(ip, &addr.sin_addr) == 0)
+    {
+        fprintf(stderr, "bad ip address: %s\n", ip);
+        return -1;
+    }
+
+    int ident = icmp_ident_alloc();
+    int sock = icmp_socket_open(ident);
+    if (sock == -1)
+    {
+        return -1;
+    }
+
+    struct probe_table *table = probe_table_alloc();
+    unsigned char *buffer = recv_buffer_alloc();
+    if (table == NULL || buffer == NULL)
+    {
+        fprintf(stderr, "probe table or recv buffer pool exhausted\n");
+        probe_table_release(table);
+        recv_buffer_release(buffer);
+        icmp_socket_close(sock);
+        return -1;
+    }
+    int dest_ttl = max_hops + 1;
+
+    // 先为所有探测包预约发送时间，排队时各包的等待重叠，而不是逐个等待
+    double send_at[TRACE_PROBES_PER_HOP * TRACE_MAX_HOPS];
+    double now = get_timestamp();
+    for (int i = 0; i < TRACE_PROBES_PER_HOP * max_hops; i++)
+    {
+        send_at[i] = pacer_reserve(addr.sin_addr, now);
+    }
+
+    // 一次性发出所有 TTL 的探测包，seq 编码了 TTL：seq = round * TRACE_MAX_HOPS + ttl
+    for (int round = 0; round < TRACE_PROBES_PER_HOP; round++)
+    {
+        for (int ttl = 1; ttl <= max_hops; ttl++)
+        {
+            // 被限速丢弃的探测包不登记，汇总时不计入发送数
+            double send_ts = send_at[round * max_hops + ttl - 1];
+            if (send_ts < 0)
+            {
+                continue;
+            }
+
+            // 等到预约的发送时间，期间处理已到达的应答，避免排队时间计入往返时间
+            double wait;
+            while ((wait = send_ts - get_timestamp()) > 0)
+            {
+                if (icmp_wait_readable(sock, wait) == 1)
+                {
+                    while (trace_recv(sock, buffer, IP_BUFFER_SIZE, table, ident, &dest_ttl) != -1)
+                    {
+                    }
+                }
+            }
+
+            int seq = round * TRACE_MAX_HOPS + ttl;
+            if (setsockopt(sock, IPPROTO_IP, IP_TTL, &ttl, sizeof(ttl)) == -1 ||
+                send_echo_request(sock, &addr, ident, seq) == -1)
+            {
+                perror("Send failed");
+                probe_table_release(table);
+                recv_buffer_release(buffer);
+                icmp_socket_close(sock);
+                return -1;
+            }
+            probe_table_add(table, ident, seq, get_timestamp());
+        }
+    }
+
+    // 收集应答，直到全部探测包有结果，或者到达目标且目标及更近的跳都有结果，或者超时
+    double deadline = get_timestamp() + (double)TRACE_TIMEOUT_USEC / 1000000;
+    while (table->pending > 0 && trace_outstanding(table, dest_ttl))
+    {
+        double remaining = deadline - get_timestamp();
+        if (remaining <= 0)
+        {
+            break;
+        }
+
+        // 等待期间继续执行后台的持续探测
+        int ret = icmp_wait_readable(sock, remaining);
+        if (ret == -1)
+        {
+            break;
+        }
+        // 读空接收队列
+        while (ret > 0 && trace_recv(sock, buffer, IP_BUFFER_SIZE, table, ident, &dest_ttl) != -1)
+        {
+        }
+    }
+    recv_buffer_release(buffer);
+    icmp_socket_close(sock);
+
+    // 按跳汇总
+    *hop_count = dest_ttl <= max_hops ? dest_ttl : max_hops;
+    for (int ttl = 1; ttl <= *hop_count; ttl++)
+    {
+        struct hop_result *hop = &hops[ttl - 1];
+        bzero(hop, sizeof(*hop));
+        hop->ttl = ttl;
+        double sum = 0;
+        for (int round = 0; round < TRACE_PROBES_PER_HOP; round++)
+        {
+            struct probe_entry *e = &table->entries[(round * TRACE_MAX_HOPS + ttl) & (PROBE_TABLE_SIZE - 1)];
+            if (e->state == PROBE_FREE)
+            {
+                continue;
+            }
+            hop->sent++;
+            if (e->state != PROBE_DONE)
+            {
+                continue;
+            }
+            if (hop->received == 0 || e->time < hop->min)
+            {
+                hop->min = e->time;
+            }
+            if (e->time > hop->max)
+            {
+                hop->max = e->time;
+            }
+            sum += e->time;
+            hop->received++;
+            strcpy(hop->ipv4_hop, inet_ntoa(e->from));
+        }
+        hop->avg = hop->received > 0 ? sum / hop->received : 0;
+    }
+
+    probe_table_release(table);
+    return 0;
+}
@@ -0,0 +1,35 @@
+#ifndef TRACEROUTE_H
+#define TRACEROUTE_H
+
+#include "icmp_ping.h"
+
+#define TRACE_MAX_HOPS 30             /**< 最大跳数 */
+#define TRACE_PROBES_PER_HOP 3        /**< 每一跳发送的探测包个数 */
+#define TRACE_TIMEOUT_USEC 1000000    /**< 最后一个探测包发出后的等待时间（微秒） */
+
+/**
+ * @brief hop_result 每一跳的探测结果
+ */
+struct hop_result
+{
+    int ttl;                  // 跳数
+    char ipv4_hop[IPV4_LEN];  // 应答的路由器ip，无应答为空
+    int sent;                 // 发送的包个数
+    int received;             // 收到的应答个数
+    double min;               // ms
+    double avg;               // ms
+    double max;               // ms
+};
+
+/**
+ * @brief 并行路由追踪：一次性发出所有 TTL 的探测包，通过探测分发表把 Time Exceeded 引用对应回原始探测包
+ *        整条路径约在一个 RTT 加超时时间内完成，而不是 跳数 × 超时时间
+ * @param ip 目标主机的 IP 地址字符串
+ * @param max_hops 最大跳数（1 ~ TRACE_MAX_HOPS）
+ * @param hops 每一跳的结果 (传入struct hop_result hops[TRACE_MAX_HOPS];)
+ * @param hop_count 实际路径长度，到达目标时为目标所在跳数，否则为 max_hops
+ * @return 成功返回0，失败返回-1
+ */
+int traceroute(const char *ip, int max_hops, struct hop_result *hops, int *hop_count);
+
+#endif /* TRACEROUTE_H */